@@ -21,6 +21,8 @@
  */
 
 #include<stdint.h>
+#include<stddef.h>
+#include<omp.h>
 #include<ndlib.h>
 
 // Determine the annotation value at the next level of the hierarchy from a 2x2
@@ -200,3 +202,209 @@ void addAnnotationData(uint64_t * volume, uint64_t * output, int * cubes, int *
                 output[output_index] = annotation;
             }
 }
+
+
+/*
+ * OpenMP addData variants with a generalized power-of-two factor
+ *
+ * Parallel over z slabs and reduce by any power-of-two factor in one
+ * call by iterating the 2x2 (or 2x2x2) vote in a block-local window, so
+ * a 4x reduction gives the same result as two passes of the legacy
+ * kernels without materializing the intermediate level. Unlike the
+ * legacy entry points the output extents are passed explicitly
+ * (outdims, [z,y,x]) and offset is the voxel offset of the reduced
+ * block inside output.
+ */
+
+#define GEN_ADD_DATA_ZSLICE( NAME, TYPE, VOTE )                                \
+void NAME ( TYPE * cube, TYPE * output, int * offset, int * dims,              \
+            int * outdims, int factor )                                        \
+{                                                                              \
+  int zdim = dims[0];                                                          \
+  int ydim = dims[1];                                                          \
+  int xdim = dims[2];                                                          \
+  int oydim = outdims[1];                                                      \
+  int oxdim = outdims[2];                                                      \
+  int i;                                                                       \
+                                                                               \
+  _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)" ) \
+  for ( i=0; i<zdim; i++ )                                                     \
+  {                                                                            \
+    int j,k,a,b,s;                                                             \
+    TYPE win[factor*factor];                                                   \
+                                                                               \
+    for ( j=0; j<(ydim/factor); j++ )                                          \
+      for ( k=0; k<(xdim/factor); k++ )                                        \
+      {                                                                        \
+        for ( a=0; a<factor; a++ )                                             \
+          for ( b=0; b<factor; b++ )                                           \
+            win[ (a*factor)+(b) ] =                                            \
+              cube[ ((size_t)i*ydim*xdim) + ((size_t)(j*factor+a)*xdim) + (k*factor+b) ]; \
+                                                                               \
+        /* compacted writes stay at or below the reads, so reducing in */      \
+        /* place is safe */                                                    \
+        for ( s=factor; s>1; s/=2 )                                            \
+          for ( a=0; a<(s/2); a++ )                                            \
+            for ( b=0; b<(s/2); b++ )                                          \
+              win[ (a*(s/2))+(b) ] = VOTE ( win[ (a*2*s)+(b*2) ],              \
+                                            win[ (a*2*s)+(b*2+1) ],            \
+                                            win[ ((a*2+1)*s)+(b*2) ],          \
+                                            win[ ((a*2+1)*s)+(b*2+1) ] );      \
+                                                                               \
+        output[ ((size_t)(i+offset[2])*oydim*oxdim)                            \
+                + ((size_t)(j+offset[1])*oxdim) + (k+offset[0]) ] = win[0];    \
+      }                                                                        \
+  }                                                                            \
+}
+
+GEN_ADD_DATA_ZSLICE ( addDataZSliceOMP, uint32_t, getAnnValue )
+GEN_ADD_DATA_ZSLICE ( addDataZSliceOMP64, uint64_t, getAnnValue64 )
+
+#define GEN_ADD_DATA_ISOTROPIC( NAME, TYPE, VOTE )                             \
+void NAME ( TYPE * cube, TYPE * output, int * offset, int * dims,              \
+            int * outdims, int factor )                                        \
+{                                                                              \
+  int zdim = dims[0];                                                          \
+  int ydim = dims[1];                                                          \
+  int xdim = dims[2];                                                          \
+  int oydim = outdims[1];                                                      \
+  int oxdim = outdims[2];                                                      \
+  int i;                                                                       \
+                                                                               \
+  _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)" ) \
+  for ( i=0; i<(zdim/factor); i++ )                                            \
+  {                                                                            \
+    int j,k,a,b,c,s;                                                           \
+    TYPE win[factor*factor*factor];                                            \
+    TYPE value;                                                                \
+                                                                               \
+    for ( j=0; j<(ydim/factor); j++ )                                          \
+      for ( k=0; k<(xdim/factor); k++ )                                        \
+      {                                                                        \
+        for ( c=0; c<factor; c++ )                                             \
+          for ( a=0; a<factor; a++ )                                           \
+            for ( b=0; b<factor; b++ )                                         \
+              win[ (c*factor*factor)+(a*factor)+(b) ] =                        \
+                cube[ ((size_t)(i*factor+c)*ydim*xdim)                         \
+                      + ((size_t)(j*factor+a)*xdim) + (k*factor+b) ];          \
+                                                                               \
+        /* per level: vote the top 2x2, fall through to the bottom 2x2 */      \
+        /* when it is empty, matching addDataIsotropic */                      \
+        for ( s=factor; s>1; s/=2 )                                            \
+          for ( c=0; c<(s/2); c++ )                                            \
+            for ( a=0; a<(s/2); a++ )                                          \
+              for ( b=0; b<(s/2); b++ )                                        \
+              {                                                                \
+                value = VOTE ( win[ (c*2*s*s)+(a*2*s)+(b*2) ],                 \
+                               win[ (c*2*s*s)+(a*2*s)+(b*2+1) ],               \
+                               win[ (c*2*s*s)+((a*2+1)*s)+(b*2) ],             \
+                               win[ (c*2*s*s)+((a*2+1)*s)+(b*2+1) ] );         \
+                if ( value == 0 )                                              \
+                  value = VOTE ( win[ ((c*2+1)*s*s)+(a*2*s)+(b*2) ],           \
+                                 win[ ((c*2+1)*s*s)+(a*2*s)+(b*2+1) ],         \
+                                 win[ ((c*2+1)*s*s)+((a*2+1)*s)+(b*2) ],       \
+                                 win[ ((c*2+1)*s*s)+((a*2+1)*s)+(b*2+1) ] );   \
+                win[ (c*(s/2)*(s/2))+(a*(s/2))+(b) ] = value;                  \
+              }                                                                \
+                                                                               \
+        output[ ((size_t)(i+offset[2])*oydim*oxdim)                            \
+                + ((size_t)(j+offset[1])*oxdim) + (k+offset[0]) ] = win[0];    \
+      }                                                                        \
+  }                                                                            \
+}
+
+GEN_ADD_DATA_ISOTROPIC ( addDataIsotropicOMP, uint32_t, getAnnValue )
+GEN_ADD_DATA_ISOTROPIC ( addDataIsotropicOMP64, uint64_t, getAnnValue64 )
+
+
+/*
+ * OpenMP + branchless addAnnotationData
+ *
+ * Same contract and exact vote semantics as addAnnotationData, reworked
+ * for throughput: the OFFSET math is hoisted into per-axis strides, the
+ * x/y loops run under OpenMP, and the vote is expressed as
+ * compare-and-select chains with no data-dependent branches so the
+ * inner z loop vectorizes. When cube_z is 2 the fall-through quad is
+ * voted unconditionally and selected in, which touches only addresses
+ * the legacy kernel reads on its own fall-through path.
+ *
+ * Note the legacy OFFSET macro does not parenthesize its arguments, so
+ * OFFSET(z, y, x + 1) steps one voxel (+ size_z * size_y), not one
+ * cube; the neighbor deltas below reproduce that exactly.
+ */
+void addAnnotationDataOMP ( uint64_t * volume, uint64_t * output, int * cubes, int * dims )
+{
+    int x,y;
+
+    int dim_z = dims[0];
+    int dim_y = dims[1];
+    int dim_x = dims[2];
+
+    int cube_z = cubes[0];
+    int cube_y = cubes[1];
+    int cube_x = cubes[2];
+
+    size_t size_z = (size_t)dim_z * cube_z;
+    size_t size_y = (size_t)dim_y * cube_y;
+
+    // block-corner strides per output step along each axis
+    size_t cornerX = (size_t)cube_x * size_z * size_y;
+    size_t cornerY = (size_t)cube_y * size_z;
+    size_t cornerZ = (size_t)cube_z;
+
+    // one-voxel neighbor deltas of the legacy OFFSET macro
+    size_t strideX = size_z * size_y;
+    size_t strideY = size_z;
+    size_t strideZ = 1;
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) collapse(2) schedule(static) private(x,y)
+    for ( x=0; x<dim_x; x++ )
+        for ( y=0; y<dim_y; y++ )
+        {
+            int z;
+            size_t base = ( cornerX * x ) + ( cornerY * y );
+            uint64_t * out = output + ( (size_t)x * dim_y * dim_z ) + ( (size_t)y * dim_z );
+
+            if ( cube_z == 2 )
+            {
+#pragma omp simd
+                for ( z=0; z<dim_z; z++ )
+                {
+                    size_t idx = base + cornerZ * z;
+                    uint64_t v00 = volume[idx];
+                    uint64_t v01 = volume[idx + strideX];
+                    uint64_t v10 = volume[idx + strideY];
+                    uint64_t v11 = volume[idx + strideX + strideY];
+                    uint64_t v = v00 ? v00 : v01;
+                    v = ( v10 != 0 && ( v == 0 || v10 == v00 || v10 == v01 ) ) ? v10 : v;
+                    v = ( v11 != 0 && v != 0 && ( v11 == v00 || v11 == v01 || v11 == v10 ) ) ? v11 : v;
+
+                    uint64_t w00 = volume[idx + strideZ];
+                    uint64_t w01 = volume[idx + strideZ + strideX];
+                    uint64_t w10 = volume[idx + strideZ + strideY];
+                    uint64_t w11 = volume[idx + strideZ + strideX + strideY];
+                    uint64_t w = w00 ? w00 : w01;
+                    w = ( w10 != 0 && ( w == 0 || w10 == w00 || w10 == w01 ) ) ? w10 : w;
+                    w = ( w11 != 0 && w != 0 && ( w11 == w00 || w11 == w01 || w11 == w10 ) ) ? w11 : w;
+
+                    out[z] = v ? v : w;
+                }
+            }
+            else
+            {
+#pragma omp simd
+                for ( z=0; z<dim_z; z++ )
+                {
+                    size_t idx = base + cornerZ * z;
+                    uint64_t v00 = volume[idx];
+                    uint64_t v01 = volume[idx + strideX];
+                    uint64_t v10 = volume[idx + strideY];
+                    uint64_t v11 = volume[idx + strideX + strideY];
+                    uint64_t v = v00 ? v00 : v01;
+                    v = ( v10 != 0 && ( v == 0 || v10 == v00 || v10 == v01 ) ) ? v10 : v;
+                    v = ( v11 != 0 && v != 0 && ( v11 == v00 || v11 == v01 || v11 == v10 ) ) ? v11 : v;
+                    out[z] = v;
+                }
+            }
+        }
+}
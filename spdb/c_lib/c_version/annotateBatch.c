@@ -0,0 +1,165 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Batched annotate / shave engine
+ *
+ * Applies many (annid, locations[]) groups against one cuboid in a
+ * single call instead of one ctypes round trip per object. The groups
+ * share a flat locations array; groupOffsets holds nGroups+1 prefix
+ * sums delimiting each group's slice of it. Group g writes its
+ * exception (and zeroed) records into the same slice of the output
+ * arrays, so the per-group segments never overlap and the groups can
+ * run on separate threads. Counts come back through the
+ * exceptionCounts / zeroedCounts out arrays as real element counts
+ * (0 means none), not the start-at-minus-one index convention the
+ * single-id entry points return.
+ *
+ * Two groups may still touch the same voxel, so the label updates go
+ * through atomics: 'P' and 'E' claim empty voxels with a compare and
+ * swap, and 'O' is a plain atomic store (overwrite always ends with
+ * the group's id, same as the sequential code). Any other conflict
+ * option behaves like 'P', matching the fall-through in annotateCube.
+ */
+
+#include<stdint.h>
+#include<omp.h>
+#include<ndlib.h>
+
+#define GEN_ANNOTATE_BATCH( NAME, TYPE )                                            \
+void NAME ( TYPE * data, int dataSize, int * dims, TYPE * annids, uint32_t * offset, \
+            uint32_t locations[][3], int * groupOffsets, int nGroups,               \
+            char conflictopt, uint32_t exceptions[][3], int * exceptionCounts )     \
+{                                                                                   \
+    int g;                                                                          \
+                                                                                    \
+    uint32_t xoffset = offset[0];                                                   \
+    uint32_t yoffset = offset[1];                                                   \
+    uint32_t zoffset = offset[2];                                                   \
+                                                                                    \
+    int ydim = dims[1];                                                             \
+    int zdim = dims[2];                                                             \
+                                                                                    \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)" ) \
+    for ( g=0; g<nGroups; g++ )                                                     \
+    {                                                                               \
+      int i, index, count = 0;                                                      \
+      int start = groupOffsets[g];                                                  \
+      int end = groupOffsets[g+1];                                                  \
+      TYPE annid = annids[g];                                                       \
+                                                                                    \
+      for ( i=start; i<end; i++ )                                                   \
+      {                                                                             \
+        TYPE expected = 0;                                                          \
+                                                                                    \
+        index = (locations[i][2]-zoffset)*(ydim*zdim) + (locations[i][1]-yoffset)*(zdim) + (locations[i][0]-xoffset); \
+                                                                                    \
+        if ( conflictopt == 'O' )                                                   \
+        {                                                                           \
+          __atomic_store_n ( &data[index], annid, __ATOMIC_RELAXED );               \
+          continue;                                                                 \
+        }                                                                           \
+                                                                                    \
+        /* claim the voxel if it is unlabelled */                                   \
+        if ( __atomic_compare_exchange_n ( &data[index], &expected, annid, 0,       \
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )   \
+          continue;                                                                 \
+                                                                                    \
+        if ( conflictopt == 'E' && expected != annid )                              \
+        {                                                                           \
+          exceptions [start+count][0] = locations[i][0]-xoffset;                    \
+          exceptions [start+count][1] = locations[i][1]-yoffset;                    \
+          exceptions [start+count][2] = locations[i][2]-zoffset;                    \
+          count += 1;                                                               \
+        }                                                                           \
+      }                                                                             \
+                                                                                    \
+      exceptionCounts[g] = count;                                                   \
+    }                                                                               \
+}
+
+GEN_ANNOTATE_BATCH ( annotateCubeBatch, uint32_t )
+GEN_ANNOTATE_BATCH ( annotateCubeBatch8, uint8_t )
+GEN_ANNOTATE_BATCH ( annotateCubeBatch16, uint16_t )
+GEN_ANNOTATE_BATCH ( annotateCubeBatch64, uint64_t )
+
+/*
+ * Batched shave. Same grouping scheme; every voxel still holding the
+ * group's id is cleared (and recorded in zeroed), while voxels owned
+ * by another id land in the exceptions list so the caller can prune
+ * the exceptions table. Unlike shaveCube, the counts actually reach
+ * the caller and the zeroed records go into the zeroed array rather
+ * than aliasing the exceptions array.
+ */
+#define GEN_SHAVE_BATCH( NAME, TYPE )                                               \
+void NAME ( TYPE * data, int dataSize, int * dims, TYPE * annids, uint32_t * offset, \
+            uint32_t locations[][3], int * groupOffsets, int nGroups,               \
+            uint32_t exceptions[][3], int * exceptionCounts,                        \
+            uint32_t zeroed[][3], int * zeroedCounts )                              \
+{                                                                                   \
+    int g;                                                                          \
+                                                                                    \
+    uint32_t xoffset = offset[0];                                                   \
+    uint32_t yoffset = offset[1];                                                   \
+    uint32_t zoffset = offset[2];                                                   \
+                                                                                    \
+    int ydim = dims[1];                                                             \
+    int zdim = dims[2];                                                             \
+                                                                                    \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)" ) \
+    for ( g=0; g<nGroups; g++ )                                                     \
+    {                                                                               \
+      int i, index, exCount = 0, zCount = 0;                                        \
+      int start = groupOffsets[g];                                                  \
+      int end = groupOffsets[g+1];                                                  \
+      TYPE annid = annids[g];                                                       \
+                                                                                    \
+      for ( i=start; i<end; i++ )                                                   \
+      {                                                                             \
+        TYPE expected = annid;                                                      \
+                                                                                    \
+        index = (locations[i][2]-zoffset)*(ydim*zdim) + (locations[i][1]-yoffset)*(zdim) + (locations[i][0]-xoffset); \
+                                                                                    \
+        /* if it's labelled with our id then remove the label */                    \
+        if ( __atomic_compare_exchange_n ( &data[index], &expected, 0, 0,           \
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )   \
+        {                                                                           \
+          zeroed [start+zCount][0] = locations[i][0]-xoffset;                       \
+          zeroed [start+zCount][1] = locations[i][1]-yoffset;                       \
+          zeroed [start+zCount][2] = locations[i][2]-zoffset;                       \
+          zCount += 1;                                                              \
+        }                                                                           \
+                                                                                    \
+        /* already labelled voxels may be in the exceptions list */                 \
+        else if ( expected != 0 )                                                   \
+        {                                                                           \
+          exceptions [start+exCount][0] = locations[i][0]-xoffset;                  \
+          exceptions [start+exCount][1] = locations[i][1]-yoffset;                  \
+          exceptions [start+exCount][2] = locations[i][2]-zoffset;                  \
+          exCount += 1;                                                             \
+        }                                                                           \
+      }                                                                             \
+                                                                                    \
+      exceptionCounts[g] = exCount;                                                 \
+      zeroedCounts[g] = zCount;                                                     \
+    }                                                                               \
+}
+
+GEN_SHAVE_BATCH ( shaveCubeBatch, uint32_t )
+GEN_SHAVE_BATCH ( shaveCubeBatch8, uint8_t )
+GEN_SHAVE_BATCH ( shaveCubeBatch16, uint16_t )
+GEN_SHAVE_BATCH ( shaveCubeBatch64, uint64_t )
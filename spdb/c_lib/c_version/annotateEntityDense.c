@@ -1,12 +1,12 @@
 /*
 * Copyright 2014 NeuroData (http://neurodata.io)
-* 
+*
 * Licensed under the Apache License, Version 2.0 (the "License");
 * you may not use this file except in compliance with the License.
 * You may obtain a copy of the License at
-* 
+*
 *     http://www.apache.org/licenses/LICENSE-2.0
-* 
+*
 * Unless required by applicable law or agreed to in writing, software
 * distributed under the License is distributed on an "AS IS" BASIS,
 * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -16,27 +16,33 @@
 
 
 /*
- * Annotate Dense Entity Function 
- * Naive implementation 
+ * Annotate Dense Entity Function
+ * Naive implementation, macro expanded for each supported voxel width
  */
 
 #include<stdint.h>
 #include<ndlib.h>
 
-void annotateEntityDense( uint32_t * data, int * dims, int entityid)
-{
-		int i,j,k,index;
-
-    int xdim = dims[0];
-    int ydim = dims[1];
-    int zdim = dims[2];
-
-		for ( i=0; i<xdim; i++ )
-      for ( j=0; j<ydim; j++ )
-        for ( k=0; k<zdim; k++ )
-        {
-          index = (i*zdim*ydim)+(j*zdim)+(k);
-          if ( data[index] !=0 )
-            data[index] = entityid;
-        }
+#define GEN_ANNOTATE_ENTITY_DENSE( NAME, TYPE, IDTYPE )           \
+void NAME ( TYPE * data, int * dims, IDTYPE entityid )            \
+{                                                                 \
+    int i,j,k,index;                                              \
+                                                                  \
+    int xdim = dims[0];                                           \
+    int ydim = dims[1];                                           \
+    int zdim = dims[2];                                           \
+                                                                  \
+    for ( i=0; i<xdim; i++ )                                      \
+      for ( j=0; j<ydim; j++ )                                    \
+        for ( k=0; k<zdim; k++ )                                  \
+        {                                                         \
+          index = (i*zdim*ydim)+(j*zdim)+(k);                     \
+          if ( data[index] !=0 )                                  \
+            data[index] = entityid;                               \
+        }                                                         \
 }
+
+GEN_ANNOTATE_ENTITY_DENSE ( annotateEntityDense, uint32_t, int )   // Legacy entry point keeps its int id
+GEN_ANNOTATE_ENTITY_DENSE ( annotateEntityDense8, uint8_t, uint8_t )
+GEN_ANNOTATE_ENTITY_DENSE ( annotateEntityDense16, uint16_t, uint16_t )
+GEN_ANNOTATE_ENTITY_DENSE ( annotateEntityDense64, uint64_t, uint64_t )
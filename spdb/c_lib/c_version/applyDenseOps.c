@@ -0,0 +1,76 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Fused dense merge engine
+ *
+ * An annotation write can run overwriteDense then exceptionDense (and
+ * sometimes shaveDense) back to back, traversing the same cuboid once
+ * per operation. applyDenseOps takes an ordered list of (op, operand)
+ * descriptors and applies them all to each voxel in one OpenMP pass,
+ * so the cuboid and each operand stream through memory exactly once no
+ * matter how many operations are fused. Per-voxel semantics match the
+ * single-op kernels: overwrite takes every nonzero operand voxel,
+ * exception only fills voxels still zero, shave clears voxels the
+ * operand marks. Order matters and is the caller's op order, exactly
+ * as if the single-op kernels had run sequentially.
+ */
+
+#include<stdint.h>
+#include<omp.h>
+#include<ndlib.h>
+
+#define GEN_APPLY_DENSE_OPS( NAME, TYPE )                                 \
+void NAME ( TYPE * data, TYPE ** operands, int * ops, int nOps, int64_t n ) \
+{                                                                         \
+    int64_t i;                                                            \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<n; i++ )                                                 \
+    {                                                                     \
+      TYPE v = data[i];                                                   \
+      int o;                                                              \
+                                                                          \
+      for ( o=0; o<nOps; o++ )                                            \
+      {                                                                   \
+        TYPE a = operands[o][i];                                          \
+                                                                          \
+        switch ( ops[o] )                                                 \
+        {                                                                 \
+          case NDLIB_DENSE_OVERWRITE:                                     \
+            if ( a != 0 )                                                 \
+              v = a;                                                      \
+            break;                                                        \
+          case NDLIB_DENSE_EXCEPTION:                                     \
+            if ( a != 0 && v == 0 )                                       \
+              v = a;                                                      \
+            break;                                                        \
+          case NDLIB_DENSE_SHAVE:                                         \
+            if ( a != 0 )                                                 \
+              v = 0;                                                      \
+            break;                                                        \
+        }                                                                 \
+      }                                                                   \
+                                                                          \
+      data[i] = v;                                                        \
+    }                                                                     \
+}
+
+GEN_APPLY_DENSE_OPS ( applyDenseOps, uint32_t )
+GEN_APPLY_DENSE_OPS ( applyDenseOps8, uint8_t )
+GEN_APPLY_DENSE_OPS ( applyDenseOps16, uint16_t )
+GEN_APPLY_DENSE_OPS ( applyDenseOps64, uint64_t )
@@ -0,0 +1,430 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Benchmark driver for the ndlib kernels
+ *
+ * Built by the bench target in makefile_LINUX and linked against
+ * ndlib.so. Exercises the exported kernel families (filter, morton,
+ * sort/unique, dense annotate/shave/exception/overwrite/merge, recolor,
+ * zoom, isotropic, addData, cutout assembly) on a realistic 512x512x16
+ * cuboid at every supported voxel width, sweeping OpenMP thread counts
+ * for the parallel kernels.
+ *
+ * Each measurement is printed as one JSON record with ns/voxel and
+ * effective GB/s so runs can be diffed across commits:
+ *
+ *   ./bench > bench.json
+ *
+ * Timings take the best of BENCH_REPS runs to suppress scheduling noise.
+ */
+
+#include<stdio.h>
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<omp.h>
+#include<ndlib.h>
+
+// declared in addData.c but not exported through ndlib.h
+void addDataZSlice ( uint32_t * , uint32_t * , int * , int * );
+void addDataIsotropic ( uint32_t * , uint32_t * , int * , int * );
+void addAnnotationData ( uint64_t * , uint64_t * , int * , int * );
+
+#define XDIM 512
+#define YDIM 512
+#define ZDIM 16
+#define NVOXELS ((size_t)XDIM * YDIM * ZDIM)
+
+#define BENCH_REPS 3
+#define FILTER_IDS 64
+#define NLOCATIONS 32768
+
+static int firstRecord = 1;
+
+static double nowNs ( void )
+{
+  struct timespec ts;
+  clock_gettime ( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Emit one JSON record. bytes is the number of bytes the kernel touches
+// (reads + writes) so gb_per_s reflects effective memory throughput.
+static void report ( const char * kernel, const char * dtype, int threads,
+                     size_t voxels, size_t bytes, double ns )
+{
+  printf ( "%s\n  {\"kernel\": \"%s\", \"dtype\": \"%s\", \"threads\": %d, \"voxels\": %zu, "
+           "\"ns_per_voxel\": %.4f, \"gb_per_s\": %.3f}",
+           firstRecord ? "" : ",", kernel, dtype, threads, voxels,
+           ns / (double)voxels, (double)bytes / ns );
+  firstRecord = 0;
+}
+
+// Run fn BENCH_REPS times via the BENCH macro and keep the fastest run
+#define BENCH( kernel, dtype, threads, voxels, bytes, setup, call )  \
+do {                                                                 \
+  int _r;                                                            \
+  double _best = 0;                                                  \
+  for ( _r=0; _r<BENCH_REPS; _r++ )                                  \
+  {                                                                  \
+    double _t0, _t1;                                                 \
+    setup;                                                           \
+    _t0 = nowNs ();                                                  \
+    call;                                                            \
+    _t1 = nowNs ();                                                  \
+    if ( _r == 0 || _t1 - _t0 < _best )                              \
+      _best = _t1 - _t0;                                             \
+  }                                                                  \
+  report ( kernel, dtype, threads, voxels, bytes, _best );           \
+} while (0)
+
+// Fill a buffer of width-byte integers with ids in [0, range)
+static void fillIds ( void * buf, int width, size_t n, uint64_t range )
+{
+  size_t i;
+  uint64_t v = 12345;
+  for ( i=0; i<n; i++ )
+  {
+    v = v * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint64_t id = ( v >> 33 ) % range;
+    switch ( width )
+    {
+      case 1: ((uint8_t*)buf)[i] = (uint8_t)id; break;
+      case 2: ((uint16_t*)buf)[i] = (uint16_t)id; break;
+      case 4: ((uint32_t*)buf)[i] = (uint32_t)id; break;
+      case 8: ((uint64_t*)buf)[i] = id; break;
+    }
+  }
+}
+
+static void benchFilter ( int threads )
+{
+  uint32_t * data32 = malloc ( NVOXELS * 4 );
+  uint64_t * data64 = malloc ( NVOXELS * 8 );
+  uint32_t filter32[FILTER_IDS];
+  uint64_t filter64[FILTER_IDS];
+  int i;
+
+  for ( i=0; i<FILTER_IDS; i++ )
+  {
+    filter32[i] = i * 31 + 7;
+    filter64[i] = i * 31 + 7;
+  }
+
+  BENCH ( "filterCutout", "uint32", 1, NVOXELS, NVOXELS * 8,
+          fillIds ( data32, 4, NVOXELS, 2000 ),
+          filterCutout ( data32, NVOXELS, filter32, FILTER_IDS ) );
+  BENCH ( "filterCutoutOMP32", "uint32", threads, NVOXELS, NVOXELS * 8,
+          fillIds ( data32, 4, NVOXELS, 2000 ),
+          filterCutoutOMP32 ( data32, NVOXELS, filter32, FILTER_IDS ) );
+  BENCH ( "filterCutoutOMP64", "uint64", threads, NVOXELS, NVOXELS * 16,
+          fillIds ( data64, 8, NVOXELS, 2000 ),
+          filterCutoutOMP64 ( data64, NVOXELS, filter64, FILTER_IDS ) );
+  BENCH ( "filterCutoutSIMD32", "uint32", threads, NVOXELS, NVOXELS * 8,
+          fillIds ( data32, 4, NVOXELS, 2000 ),
+          filterCutoutSIMD32 ( data32, NVOXELS, filter32, FILTER_IDS ) );
+  BENCH ( "filterCutoutSIMD64", "uint64", threads, NVOXELS, NVOXELS * 16,
+          fillIds ( data64, 8, NVOXELS, 2000 ),
+          filterCutoutSIMD64 ( data64, NVOXELS, filter64, FILTER_IDS ) );
+  BENCH ( "filterCutoutOMPCache", "uint32", threads, NVOXELS, NVOXELS * 8,
+          fillIds ( data32, 4, NVOXELS, 2000 ),
+          filterCutoutOMPCache ( data32, NVOXELS, filter32, FILTER_IDS ) );
+  BENCH ( "filterCutoutOMPCache64", "uint64", threads, NVOXELS, NVOXELS * 16,
+          fillIds ( data64, 8, NVOXELS, 2000 ),
+          filterCutoutOMPCache64 ( data64, NVOXELS, filter64, FILTER_IDS ) );
+
+  free ( data32 );
+  free ( data64 );
+}
+
+static void benchMorton ( void )
+{
+  static uint64_t xyz[NLOCATIONS][3];
+  static uint64_t mortons[NLOCATIONS];
+  int i;
+
+  for ( i=0; i<NLOCATIONS; i++ )
+  {
+    xyz[i][0] = i % 64;
+    xyz[i][1] = ( i / 64 ) % 64;
+    xyz[i][2] = i / 4096;
+  }
+
+  BENCH ( "XYZMorton", "uint64", 1, NLOCATIONS, NLOCATIONS * 8, ,
+          for ( i=0; i<NLOCATIONS; i++ ) mortons[i] = XYZMorton ( xyz[i] ) );
+  BENCH ( "XYZMortonBatch", "uint64", 1, NLOCATIONS, NLOCATIONS * 32, ,
+          XYZMortonBatch ( xyz, NLOCATIONS, mortons ) );
+  BENCH ( "MortonXYZBatch", "uint64", 1, NLOCATIONS, NLOCATIONS * 32,
+          memset ( xyz, 0, sizeof ( xyz ) ),
+          MortonXYZBatch ( mortons, NLOCATIONS, xyz ) );
+}
+
+static void benchSort ( int threads )
+{
+  static uint64_t locs[NLOCATIONS][4];
+  static uint32_t locations[NLOCATIONS][3];
+  int dims[3] = { XDIM, YDIM, ZDIM };
+  uint64_t * data = malloc ( NVOXELS * 8 );
+  uint64_t * out = malloc ( NVOXELS * 8 );
+  int i;
+
+  for ( i=0; i<NLOCATIONS; i++ )
+  {
+    locations[i][0] = ( i * 2654435761u ) % 4096;
+    locations[i][1] = ( i * 40503u ) % 4096;
+    locations[i][2] = i % 256;
+  }
+
+  BENCH ( "locateCube+quicksort", "uint64", 1, NLOCATIONS, NLOCATIONS * 32, ,
+          { locateCube ( locs, NLOCATIONS, locations, NLOCATIONS, dims );
+            quicksort ( locs, NLOCATIONS ); } );
+  BENCH ( "locateAndSortCube", "uint64", 1, NLOCATIONS, NLOCATIONS * 32, ,
+          locateAndSortCube ( locs, NLOCATIONS, locations, NLOCATIONS, dims ) );
+
+  BENCH ( "unique", "uint64", 1, NVOXELS, NVOXELS * 16,
+          fillIds ( data, 8, NVOXELS, 5000 ),
+          unique ( data, out, NVOXELS ) );
+  BENCH ( "uniqueOMP", "uint64", threads, NVOXELS, NVOXELS * 16,
+          fillIds ( data, 8, NVOXELS, 5000 ),
+          uniqueOMP ( data, out, NVOXELS ) );
+
+  free ( data );
+  free ( out );
+}
+
+// Dense two-buffer kernels, macro expanded per voxel width
+#define BENCH_DENSE( TYPE, WIDTH, DTYPE, FN_ANNO, FN_SHAVE, FN_EXC, FN_OVER, FN_DIRTY, FN_MERGE ) \
+do {                                                                                   \
+  TYPE * data = malloc ( NVOXELS * WIDTH );                                            \
+  TYPE * anno = malloc ( NVOXELS * WIDTH );                                            \
+  uint8_t * dirty = malloc ( XDIM );                                                   \
+  int dims[3] = { XDIM, YDIM, ZDIM };                                                  \
+  fillIds ( anno, WIDTH, NVOXELS, 200 );                                               \
+                                                                                       \
+  BENCH ( #FN_ANNO, DTYPE, 1, NVOXELS, NVOXELS * WIDTH,                                \
+          fillIds ( data, WIDTH, NVOXELS, 200 ),                                       \
+          FN_ANNO ( data, dims, 7 ) );                                                 \
+  BENCH ( #FN_SHAVE, DTYPE, 1, NVOXELS, NVOXELS * 2 * WIDTH,                           \
+          fillIds ( data, WIDTH, NVOXELS, 200 ),                                       \
+          FN_SHAVE ( data, anno, dims ) );                                             \
+  BENCH ( #FN_EXC, DTYPE, 1, NVOXELS, NVOXELS * 2 * WIDTH,                             \
+          fillIds ( data, WIDTH, NVOXELS, 200 ),                                       \
+          FN_EXC ( data, anno, dims ) );                                               \
+  BENCH ( #FN_OVER, DTYPE, 1, NVOXELS, NVOXELS * 2 * WIDTH,                            \
+          fillIds ( data, WIDTH, NVOXELS, 200 ),                                       \
+          FN_OVER ( data, anno, dims ) );                                              \
+  BENCH ( #FN_DIRTY, DTYPE, 1, NVOXELS, NVOXELS * 2 * WIDTH,                           \
+          fillIds ( data, WIDTH, NVOXELS, 200 ),                                       \
+          FN_DIRTY ( data, anno, dims, dirty ) );                                      \
+  BENCH ( #FN_MERGE, DTYPE, 1, NVOXELS, NVOXELS * WIDTH,                               \
+          fillIds ( data, WIDTH, NVOXELS, 200 ),                                       \
+          FN_MERGE ( data, dims, 13, 7 ) );                                            \
+                                                                                       \
+  free ( data );                                                                       \
+  free ( anno );                                                                       \
+  free ( dirty );                                                                      \
+} while (0)
+
+static void benchDense ( void )
+{
+  BENCH_DENSE ( uint8_t, 1, "uint8", annotateEntityDense8, shaveDense8, exceptionDense8,
+                overwriteDense8, overwriteDenseDirty8, mergeCube8 );
+  BENCH_DENSE ( uint16_t, 2, "uint16", annotateEntityDense16, shaveDense16, exceptionDense16,
+                overwriteDense16, overwriteDenseDirty16, mergeCube16 );
+  BENCH_DENSE ( uint32_t, 4, "uint32", annotateEntityDense, shaveDense, exceptionDense,
+                overwriteDense, overwriteDenseDirty, mergeCube );
+  BENCH_DENSE ( uint64_t, 8, "uint64", annotateEntityDense64, shaveDense64, exceptionDense64,
+                overwriteDense64, overwriteDenseDirty64, mergeCube64 );
+}
+
+static void benchRecolor ( int threads )
+{
+  size_t n = (size_t)XDIM * YDIM;
+  uint32_t * in32 = malloc ( n * 4 );
+  uint32_t * out32 = malloc ( n * 4 );
+  uint64_t * in64 = malloc ( n * 8 );
+  uint64_t * out64 = malloc ( n * 8 );
+  uint32_t palette32[217];
+  uint64_t palette64[217];
+  int i;
+
+  for ( i=0; i<217; i++ )
+  {
+    palette32[i] = 0xff000000u | (uint32_t)i;
+    palette64[i] = 0xff000000u | (uint64_t)i;
+  }
+  fillIds ( in32, 4, n, 100000 );
+  fillIds ( in64, 8, n, 100000 );
+
+  BENCH ( "recolorCubeOMP32", "uint32", threads, n, n * 8, ,
+          recolorCubeOMP32 ( (uint32_t*)in32, YDIM, XDIM, (uint32_t*)out32, palette32 ) );
+  BENCH ( "recolorCubeOMP64", "uint64", threads, n, n * 16, ,
+          recolorCubeOMP64 ( (uint64_t*)in64, YDIM, XDIM, (uint64_t*)out64, palette64 ) );
+
+  free ( in32 );
+  free ( out32 );
+  free ( in64 );
+  free ( out64 );
+}
+
+static void benchZoom ( int threads )
+{
+  // zoom kernels take the dims of newdata in z,y,x order; factor 1 scales
+  // x and y by 2, so the coarse buffer is a quarter of the fine buffer
+  int dims[3] = { ZDIM, YDIM, XDIM };
+  uint32_t * small32 = malloc ( NVOXELS * 4 );
+  uint32_t * big32 = malloc ( NVOXELS * 4 * 4 );
+  uint16_t * small16 = malloc ( NVOXELS * 2 );
+  uint16_t * big16 = malloc ( NVOXELS * 2 * 4 );
+
+  fillIds ( small32, 4, NVOXELS, 200 );
+  fillIds ( big32, 4, NVOXELS * 4, 200 );
+  fillIds ( small16, 2, NVOXELS, 200 );
+
+  BENCH ( "zoomOutData", "uint32", 1, NVOXELS, NVOXELS * 5 * 4,
+          memset ( small32, 0, NVOXELS * 4 ),
+          zoomOutData ( big32, small32, dims, 1 ) );
+  BENCH ( "zoomOutDataOMP", "uint32", threads, NVOXELS, NVOXELS * 5 * 4,
+          memset ( small32, 0, NVOXELS * 4 ),
+          zoomOutDataOMP ( big32, small32, dims, 1 ) );
+  BENCH ( "zoomInData", "uint32", 1, NVOXELS, NVOXELS * 2 * 4, ,
+          zoomInData ( small32, big32, dims, 1 ) );
+  BENCH ( "zoomInDataOMP32", "uint32", threads, NVOXELS, NVOXELS * 2 * 4, ,
+          zoomInDataOMP32 ( small32, big32, dims, 1 ) );
+  BENCH ( "zoomInDataOMP16", "uint16", threads, NVOXELS, NVOXELS * 2 * 2, ,
+          zoomInDataOMP16 ( small16, big16, dims, 1 ) );
+
+  free ( small32 );
+  free ( big32 );
+  free ( small16 );
+  free ( big16 );
+}
+
+static void benchIsotropic ( void )
+{
+  size_t n = (size_t)XDIM * YDIM;
+  uint8_t * s1 = malloc ( n * 8 );
+  uint8_t * s2 = malloc ( n * 8 );
+  uint8_t * out = malloc ( n * 8 );
+  int dims[2] = { YDIM, XDIM };
+
+  fillIds ( s1, 1, n * 8, 256 );
+  fillIds ( s2, 1, n * 8, 256 );
+
+  BENCH ( "isotropicBuild8", "uint8", 1, n, n * 3,  ,
+          isotropicBuild8 ( s1, s2, out, dims ) );
+  BENCH ( "isotropicBuild16", "uint16", 1, n, n * 6, ,
+          isotropicBuild16 ( (uint16_t*)s1, (uint16_t*)s2, (uint16_t*)out, dims ) );
+  BENCH ( "isotropicBuild32", "uint32", 1, n, n * 12, ,
+          isotropicBuild32 ( (uint32_t*)s1, (uint32_t*)s2, (uint32_t*)out, dims ) );
+  BENCH ( "isotropicBuildF32", "float32", 1, n, n * 12, ,
+          isotropicBuildF32 ( (float*)s1, (float*)s2, (float*)out, dims ) );
+
+  free ( s1 );
+  free ( s2 );
+  free ( out );
+}
+
+static void benchAddData ( void )
+{
+  int dims[3] = { ZDIM, YDIM, XDIM };
+  int offset[3] = { 0, 0, 0 };
+  int cubes[3] = { 1, 2, 2 };
+  uint32_t * cube32 = malloc ( NVOXELS * 4 );
+  // addData output indexing can address up to 4x the input cube
+  uint32_t * out32 = malloc ( NVOXELS * 4 * 4 );
+  // volume of cubes[z,y,x] cuboids of shape dims, plus stride slack
+  uint64_t * volume64 = malloc ( NVOXELS * 5 * 8 );
+  uint64_t * out64 = malloc ( NVOXELS * 8 );
+
+  fillIds ( cube32, 4, NVOXELS, 200 );
+  fillIds ( volume64, 8, NVOXELS * 5, 200 );
+
+  BENCH ( "addDataZSlice", "uint32", 1, NVOXELS / 4, NVOXELS * 4,
+          memset ( out32, 0, NVOXELS * 4 * 4 ),
+          addDataZSlice ( cube32, out32, offset, dims ) );
+  BENCH ( "addDataIsotropic", "uint32", 1, NVOXELS / 8, NVOXELS * 4,
+          memset ( out32, 0, NVOXELS * 4 * 4 ),
+          addDataIsotropic ( cube32, out32, offset, dims ) );
+  BENCH ( "addAnnotationData", "uint64", 1, NVOXELS, NVOXELS * 5 * 8,
+          memset ( out64, 0, NVOXELS * 8 ),
+          addAnnotationData ( volume64, out64, cubes, dims ) );
+
+  free ( cube32 );
+  free ( out32 );
+  free ( volume64 );
+  free ( out64 );
+}
+
+static void benchAssemble ( int threads )
+{
+  // 2x2x2 cuboid grid of uint16 voxels, one time sample
+  int cubeDims[3] = { XDIM, YDIM, ZDIM };
+  int regionDims[3] = { XDIM * 2, YDIM * 2, ZDIM * 2 };
+  uint64_t lowxyz[3] = { 0, 0, 0 };
+  uint64_t mortons[8];
+  uint8_t * cuboids[8];
+  uint8_t * region = malloc ( NVOXELS * 8 * 2 );
+  int i;
+
+  for ( i=0; i<8; i++ )
+  {
+    uint64_t xyz[3] = { i & 1, ( i >> 1 ) & 1, ( i >> 2 ) & 1 };
+    mortons[i] = XYZMorton ( xyz );
+    cuboids[i] = malloc ( NVOXELS * 2 );
+    fillIds ( cuboids[i], 2, NVOXELS, 65536 );
+  }
+
+  BENCH ( "assembleCutout", "uint16", threads, NVOXELS * 8, NVOXELS * 8 * 4, ,
+          assembleCutout ( region, cuboids, mortons, 8, cubeDims, regionDims, lowxyz, 1, 2 ) );
+  BENCH ( "sliceCutout", "uint16", threads, NVOXELS * 8, NVOXELS * 8 * 4, ,
+          sliceCutout ( region, cuboids, mortons, 8, cubeDims, regionDims, lowxyz, 1, 2 ) );
+
+  free ( region );
+  for ( i=0; i<8; i++ )
+    free ( cuboids[i] );
+}
+
+int main ( void )
+{
+  int maxThreads = omp_get_max_threads ();
+  int threads;
+
+  printf ( "[" );
+
+  // serial kernels, measured once
+  benchMorton ();
+  benchDense ();
+  benchIsotropic ();
+  benchAddData ();
+
+  // parallel kernels, swept over thread counts
+  for ( threads=1; threads<=maxThreads; threads*=2 )
+  {
+    omp_set_num_threads ( threads );
+    benchFilter ( threads );
+    benchSort ( threads );
+    benchRecolor ( threads );
+    benchZoom ( threads );
+    benchAssemble ( threads );
+  }
+
+  printf ( "\n]\n" );
+  return 0;
+}
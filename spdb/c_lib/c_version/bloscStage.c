@@ -0,0 +1,146 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Native blosc pipeline stage
+ *
+ * Compresses and decompresses cuboid buffers through the blosc C library
+ * without round-tripping through python-level bytes objects, and fuses
+ * decompression with the assembleCutout scatter so frames land in their
+ * final region offsets in one parallel pass.
+ *
+ * The blosc shared library is not vendored with ndlib, so it is loaded
+ * with dlopen on first use. Every entry point reports failure when blosc
+ * is unavailable and the python layer falls back to its existing
+ * python-blosc path, keeping the library free of a hard link-time
+ * dependency. Only the thread-safe _ctx blosc entry points are used so
+ * frames can be processed from OpenMP threads without blosc_init.
+ */
+
+#include<stdint.h>
+#include<stddef.h>
+#include<stdlib.h>
+#include<string.h>
+#include<dlfcn.h>
+#include<omp.h>
+#include<ndlib.h>
+
+// Matches BLOSC_MAX_OVERHEAD from blosc.h (not included since blosc is dlopen'd)
+#define BLOSC_FRAME_OVERHEAD 16
+
+typedef int ( * bloscCompressCtx ) ( int, int, size_t, size_t, const void *, void *, size_t, const char *, size_t, int );
+typedef int ( * bloscDecompressCtx ) ( const void *, void *, size_t, int );
+
+static bloscCompressCtx blosc_compress_ctx = NULL;
+static bloscDecompressCtx blosc_decompress_ctx = NULL;
+static int bloscState = 0;  // 0 untried, 1 loaded, -1 unavailable
+
+// Load the blosc shared library on first use. Returns 1 when blosc is usable.
+int bloscAvailable ( void )
+{
+  void * handle;
+
+  if ( bloscState != 0 )
+    return bloscState == 1;
+
+  handle = dlopen ( "libblosc.so.1", RTLD_NOW | RTLD_GLOBAL );
+  if ( handle == NULL )
+    handle = dlopen ( "libblosc.so", RTLD_NOW | RTLD_GLOBAL );
+
+  if ( handle != NULL )
+  {
+    blosc_compress_ctx = ( bloscCompressCtx ) dlsym ( handle, "blosc_compress_ctx" );
+    blosc_decompress_ctx = ( bloscDecompressCtx ) dlsym ( handle, "blosc_decompress_ctx" );
+  }
+
+  bloscState = ( blosc_compress_ctx != NULL && blosc_decompress_ctx != NULL ) ? 1 : -1;
+  return bloscState == 1;
+}
+
+// Compress one contiguous cuboid buffer into dest. Returns the compressed
+// size in bytes, or -1 when blosc is unavailable or compression fails.
+// typeSize matches the typesize python-blosc was called with so frames stay
+// interchangeable with the python path.
+int64_t compressCuboid ( uint8_t * src, uint64_t srcSize, int typeSize, uint8_t * dest, uint64_t destSize )
+{
+  int csize;
+
+  if ( !bloscAvailable () )
+    return -1;
+
+  // clevel 9 / shuffle / blosclz are the python-blosc compress defaults
+  csize = blosc_compress_ctx ( 9, 1, (size_t)typeSize, (size_t)srcSize, src, dest, (size_t)destSize, "blosclz", 0, 1 );
+  return csize <= 0 ? -1 : (int64_t)csize;
+}
+
+// Decompress one blosc frame into a caller-provided buffer. Returns the
+// number of bytes written, or -1 when blosc is unavailable or the frame
+// does not decompress cleanly.
+int64_t decompressCuboid ( uint8_t * frame, uint8_t * dest, uint64_t destSize )
+{
+  int dsize;
+
+  if ( !bloscAvailable () )
+    return -1;
+
+  dsize = blosc_decompress_ctx ( frame, dest, (size_t)destSize, 1 );
+  return dsize <= 0 ? -1 : (int64_t)dsize;
+}
+
+// Decompress nFrames blosc frames and scatter each one straight into its
+// region offset (the fused form of decompressCuboid + assembleCutout).
+// Frames are decompressed into a per-thread scratch cuboid and scattered
+// row-wise, overlapping decompression of one cuboid with the scatter of
+// the previous ones. Returns the number of frames that failed, or -1 when
+// blosc is unavailable so the caller can fall back wholesale.
+int decompressCutout ( uint8_t * region, uint8_t ** frames, uint64_t * mortons, int nFrames,
+                       int * cubeDims, int * regionDims, uint64_t * lowxyz,
+                       int timeSamples, int voxelSize )
+{
+  int failed = 0;
+  size_t cubeBytes = (size_t)timeSamples * cubeDims[0] * cubeDims[1] * cubeDims[2] * voxelSize;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( !bloscAvailable () )
+    return -1;
+
+  #pragma omp parallel num_threads(omp_get_max_threads()) reduction(+:failed)
+  {
+    int i;
+    uint8_t * scratch = malloc ( cubeBytes );
+
+    // every thread encounters the same worksharing loop; one whose
+    // scratch allocation failed just counts its share of the frames
+    // as failed
+    #pragma omp for
+    for ( i=0; i<nFrames; i++ )
+    {
+      if ( scratch != NULL &&
+           blosc_decompress_ctx ( frames[i], scratch, cubeBytes, 1 ) == (int)cubeBytes )
+        copyCuboidRows ( region, scratch, mortons[i], cubeDims, regionDims, lowxyz,
+                         timeSamples, voxelSize, 0 );
+      else
+        failed += 1;
+    }
+
+    free ( scratch );
+  }
+
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_DECOMPRESS,
+                   (uint64_t)nFrames * timeSamples * cubeDims[0] * cubeDims[1] * cubeDims[2] );
+  return failed;
+}
@@ -0,0 +1,217 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Pipelined decompress-and-scatter stage for the cutout read path
+ *
+ * decompressCutout needs every compressed frame up front, so the read
+ * path still waits for the whole key-value fetch before any frame is
+ * decompressed. This stage accepts frames one at a time as they arrive:
+ * submit copies the compressed frame into a bounded queue and worker
+ * threads overlap decompression of frame N+1 with the scatter of frame
+ * N into the region, so the caller's network reads run concurrently
+ * with decompression. Handoff is a condition-variable pair on the
+ * queue (submit blocks when the queue is full, workers block when it
+ * is empty) and each worker double-buffers through its own scratch
+ * cuboid. Drain closes the queue, joins the workers and reports how
+ * many frames failed so the python layer can fall back wholesale.
+ */
+
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include<pthread.h>
+#include<ndlib.h>
+
+#define PIPELINE_QUEUE_DEPTH 8
+#define PIPELINE_MAX_WORKERS 4
+
+typedef struct
+{
+  uint8_t * frame;
+  uint64_t morton;
+} CutoutFrame;
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+  CutoutFrame queue[PIPELINE_QUEUE_DEPTH];
+  int head;
+  int count;
+  int closed;
+  int failed;
+  pthread_t workers[PIPELINE_MAX_WORKERS];
+  int nWorkers;
+  uint8_t * region;
+  int cubeDims[3];
+  int regionDims[3];
+  uint64_t lowxyz[3];
+  int timeSamples;
+  int voxelSize;
+  uint64_t cubeBytes;
+} CutoutPipeline;
+
+static void * cutoutPipelineWorker ( void * arg )
+{
+  CutoutPipeline * p = arg;
+  uint8_t * scratch = malloc ( p->cubeBytes );
+
+  for ( ;; )
+  {
+    CutoutFrame item;
+
+    pthread_mutex_lock ( &p->lock );
+    while ( p->count == 0 && !p->closed )
+      pthread_cond_wait ( &p->notEmpty, &p->lock );
+    if ( p->count == 0 )
+    {
+      pthread_mutex_unlock ( &p->lock );
+      break;
+    }
+    item = p->queue[p->head];
+    p->head = ( p->head + 1 ) % PIPELINE_QUEUE_DEPTH;
+    p->count -= 1;
+    pthread_cond_signal ( &p->notFull );
+    pthread_mutex_unlock ( &p->lock );
+
+    if ( scratch != NULL && decompressCuboid ( item.frame, scratch, p->cubeBytes ) == (int64_t)p->cubeBytes )
+      copyCuboidRows ( p->region, scratch, item.morton, p->cubeDims, p->regionDims,
+                       p->lowxyz, p->timeSamples, p->voxelSize, 0 );
+    else
+      __atomic_fetch_add ( &p->failed, 1, __ATOMIC_RELAXED );
+
+    free ( item.frame );
+  }
+
+  free ( scratch );
+  return NULL;
+}
+
+// Start a pipeline scattering into region; returns NULL when blosc is
+// unavailable or the workers cannot start, so the caller can fall back
+// to the synchronous path before submitting anything
+void * cutoutPipelineCreate ( uint8_t * region, int * cubeDims, int * regionDims,
+                              uint64_t * lowxyz, int timeSamples, int voxelSize, int nWorkers )
+{
+  CutoutPipeline * p;
+  int i;
+
+  if ( !bloscAvailable () )
+    return NULL;
+
+  p = calloc ( 1, sizeof(CutoutPipeline) );
+  if ( p == NULL )
+    return NULL;
+
+  p->region = region;
+  memcpy ( p->cubeDims, cubeDims, sizeof(p->cubeDims) );
+  memcpy ( p->regionDims, regionDims, sizeof(p->regionDims) );
+  memcpy ( p->lowxyz, lowxyz, sizeof(p->lowxyz) );
+  p->timeSamples = timeSamples;
+  p->voxelSize = voxelSize;
+  p->cubeBytes = (uint64_t)timeSamples * cubeDims[0] * cubeDims[1] * cubeDims[2] * voxelSize;
+
+  pthread_mutex_init ( &p->lock, NULL );
+  pthread_cond_init ( &p->notEmpty, NULL );
+  pthread_cond_init ( &p->notFull, NULL );
+
+  if ( nWorkers < 1 )
+    nWorkers = 1;
+  if ( nWorkers > PIPELINE_MAX_WORKERS )
+    nWorkers = PIPELINE_MAX_WORKERS;
+
+  for ( i=0; i<nWorkers; i++ )
+  {
+    if ( pthread_create ( &p->workers[i], NULL, cutoutPipelineWorker, p ) != 0 )
+      break;
+    p->nWorkers += 1;
+  }
+
+  if ( p->nWorkers == 0 )
+  {
+    free ( p );
+    return NULL;
+  }
+
+  return p;
+}
+
+// Queue one compressed frame; blocks while the queue is full. The frame
+// bytes are copied, so the caller's buffer may be reused immediately.
+// Returns 0 on success, -1 when the copy cannot be allocated (the frame
+// is then counted as failed).
+int cutoutPipelineSubmit ( void * handle, uint8_t * frame, uint64_t frameBytes, uint64_t morton )
+{
+  CutoutPipeline * p = handle;
+  uint8_t * copy = malloc ( frameBytes );
+
+  if ( copy == NULL )
+  {
+    __atomic_fetch_add ( &p->failed, 1, __ATOMIC_RELAXED );
+    return -1;
+  }
+  memcpy ( copy, frame, frameBytes );
+
+  pthread_mutex_lock ( &p->lock );
+  while ( p->count == PIPELINE_QUEUE_DEPTH )
+    pthread_cond_wait ( &p->notFull, &p->lock );
+  p->queue[( p->head + p->count ) % PIPELINE_QUEUE_DEPTH].frame = copy;
+  p->queue[( p->head + p->count ) % PIPELINE_QUEUE_DEPTH].morton = morton;
+  p->count += 1;
+  pthread_cond_signal ( &p->notEmpty );
+  pthread_mutex_unlock ( &p->lock );
+
+  return 0;
+}
+
+// Close the queue and wait for the workers to finish every submitted
+// frame; returns the number of frames that failed to decompress
+int cutoutPipelineDrain ( void * handle )
+{
+  CutoutPipeline * p = handle;
+  int i;
+
+  pthread_mutex_lock ( &p->lock );
+  p->closed = 1;
+  pthread_cond_broadcast ( &p->notEmpty );
+  pthread_mutex_unlock ( &p->lock );
+
+  for ( i=0; i<p->nWorkers; i++ )
+    pthread_join ( p->workers[i], NULL );
+  p->nWorkers = 0;
+
+  return p->failed;
+}
+
+// Free the pipeline; drains first if the caller has not
+void cutoutPipelineDestroy ( void * handle )
+{
+  CutoutPipeline * p = handle;
+
+  if ( p == NULL )
+    return;
+
+  if ( p->nWorkers > 0 )
+    cutoutPipelineDrain ( p );
+
+  pthread_mutex_destroy ( &p->lock );
+  pthread_cond_destroy ( &p->notEmpty );
+  pthread_cond_destroy ( &p->notFull );
+  free ( p );
+}
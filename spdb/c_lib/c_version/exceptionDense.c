@@ -1,12 +1,12 @@
 /*
 * Copyright 2014 NeuroData (http://neurodata.io)
-* 
+*
 * Licensed under the Apache License, Version 2.0 (the "License");
 * you may not use this file except in compliance with the License.
 * You may obtain a copy of the License at
-* 
+*
 *     http://www.apache.org/licenses/LICENSE-2.0
-* 
+*
 * Unless required by applicable law or agreed to in writing, software
 * distributed under the License is distributed on an "AS IS" BASIS,
 * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -16,27 +16,33 @@
 
 
 /*
- * Exception Dense Entity Function 
- * Naive implementation 
+ * Exception Dense Entity Function
+ * Naive implementation, macro expanded for each supported voxel width
  */
 
 #include<stdint.h>
 #include<ndlib.h>
 
-void exceptionDense( uint32_t * data, uint32_t * annodata ,int * dims )
-{
-		int i,j,k,index;
-    
-    int xdim = dims[0];
-    int ydim = dims[1];
-    int zdim = dims[2];
-    
-		for ( i=0; i<xdim; i++ )
-      for ( j=0; j<ydim; j++ )
-        for ( k=0; k<zdim; k++ )
-        {
-          index = (i*zdim*ydim)+(j*zdim)+(k);
-          if ( annodata[index] !=0 && data[index] == 0 )
-            data[index] = annodata[index];
-        }
+#define GEN_EXCEPTION_DENSE( NAME, TYPE )                         \
+void NAME ( TYPE * data, TYPE * annodata, int * dims )            \
+{                                                                 \
+    int i,j,k,index;                                              \
+                                                                  \
+    int xdim = dims[0];                                           \
+    int ydim = dims[1];                                           \
+    int zdim = dims[2];                                           \
+                                                                  \
+    for ( i=0; i<xdim; i++ )                                      \
+      for ( j=0; j<ydim; j++ )                                    \
+        for ( k=0; k<zdim; k++ )                                  \
+        {                                                         \
+          index = (i*zdim*ydim)+(j*zdim)+(k);                     \
+          if ( annodata[index] !=0 && data[index] == 0 )          \
+            data[index] = annodata[index];                        \
+        }                                                         \
 }
+
+GEN_EXCEPTION_DENSE ( exceptionDense, uint32_t )   // Legacy exception function is for uint32 data
+GEN_EXCEPTION_DENSE ( exceptionDense8, uint8_t )
+GEN_EXCEPTION_DENSE ( exceptionDense16, uint16_t )
+GEN_EXCEPTION_DENSE ( exceptionDense64, uint64_t )
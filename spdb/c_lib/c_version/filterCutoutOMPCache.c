@@ -1,12 +1,12 @@
 /*
 * Copyright 2014 NeuroData (http://neurodata.io)
-* 
+*
 * Licensed under the Apache License, Version 2.0 (the "License");
 * you may not use this file except in compliance with the License.
 * You may obtain a copy of the License at
-* 
+*
 *     http://www.apache.org/licenses/LICENSE-2.0
-* 
+*
 * Unless required by applicable law or agreed to in writing, software
 * distributed under the License is distributed on an "AS IS" BASIS,
 * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -14,63 +14,200 @@
 * limitations under the License.
 */
 
+
+/*
+ * Cache optimized implementation for filterCutout
+ *
+ * Built for filter lists too large to stay L1 resident. The sorted
+ * filter list is laid out once per call in Eytzinger (BFS) order in a
+ * page-aligned buffer, so the first levels of the implicit search tree
+ * pack into a handful of cache lines and stay hot. The cutout is then
+ * tiled into L2-sized blocks and the blocks are distributed over OpenMP
+ * threads; each voxel does a branch-free descent of the tree.
+ */
+
 #include<stdio.h>
 #include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
 #include<omp.h>
 #include<stdbool.h>
+#include<ndlib.h>
 
-/* Sample Alignment Sizes */
+/* Page alignment for the search structure */
 #define ALIGNMENT 4096
 
+/* Cutout elements per block, sized so a uint64 block fits in L2 */
+#define BLOCKSIZE (1<<15)
+
+/* Recursively place a sorted list into Eytzinger (BFS) order */
+
+static int eytzingerBuild32 ( const uint32_t * sorted, uint32_t * eyt, int listsize, int in, size_t out )
+{
+  if ( out < (size_t)listsize )
+  {
+    in = eytzingerBuild32 ( sorted, eyt, listsize, in, 2*out+1 );
+    eyt[out] = sorted[in++];
+    in = eytzingerBuild32 ( sorted, eyt, listsize, in, 2*out+2 );
+  }
+  return in;
+}
+
+static int eytzingerBuild64 ( const uint64_t * sorted, uint64_t * eyt, int listsize, int in, size_t out )
+{
+  if ( out < (size_t)listsize )
+  {
+    in = eytzingerBuild64 ( sorted, eyt, listsize, in, 2*out+1 );
+    eyt[out] = sorted[in++];
+    in = eytzingerBuild64 ( sorted, eyt, listsize, in, 2*out+2 );
+  }
+  return in;
+}
+
+/* Branch-free membership test via the Eytzinger tree */
 
-void sortDataFirst (uint32_t * cutoutarray, int cutoutsize,  uint32_t * filterlist, int listsize )
+static inline bool eytzingerContains32 ( const uint32_t * eyt, int listsize, uint32_t key )
 {
+  size_t i = 0;
+  bool found = false;
 
-  for ( int i=0; i<listsize; i++)
+  while ( i < (size_t)listsize )
   {
-    printf("HELLO");
+    uint32_t v = eyt[i];
+    found |= ( v == key );
+    i = 2*i + 1 + ( v < key );
   }
+
+  return found;
 }
 
+static inline bool eytzingerContains64 ( const uint64_t * eyt, int listsize, uint64_t key )
+{
+  size_t i = 0;
+  bool found = false;
+
+  while ( i < (size_t)listsize )
+  {
+    uint64_t v = eyt[i];
+    found |= ( v == key );
+    i = 2*i + 1 + ( v < key );
+  }
+
+  return found;
+}
 
-void filterCutoutOMPCache( uint32_t * cutout, int cutoutsize, uint32_t * filterlist, int listsize)
+void filterCutoutOMPCache ( uint32_t * cutout, int cutoutsize, uint32_t * filterlist, int listsize )
 {
-		int i,j;
-		bool equal;
-
-      
-    /* Memory Align the cutout data */
-    posix_memalign ( (void**)&cutoutarray, ALIGNMENT, cutoutsize * sizeof(uint32_t) );
-    memcpy ( cutoutarray, cutout, cutoutsize * sizeof(uint32_t) );
-
-    /* Memory Align the filter list */
-    /*
-    posix_memalign ( (void**)&filterarray, ALIGNMENT, listsize * sizeof(uint32_t) );
-    memcpy ( filterarray, filterlist, listsize * sizeof(uint32_t) );
-    */
-    
-
-    for ( int filter_len = 16; filter_len<=listsize; filter_len*=2 )
-
-		printf("MAX THREADS: %d",omp_get_max_threads());
-#pragma omp parallel num_threads(omp_get_max_threads()) 
-		{
-#pragma omp for private(i,j,equal) schedule(dynamic)
-				for ( i=0; i<cutoutsize; i++)
-				{
-						equal = false;
-						for( j=0; j<listsize; j++)
-						{
-								if( cutout[i] == filterlist[j] )
-								{
-										equal = true;
-										break;
-								}
-						}
-						if( !equal || cutout[i] > filterlist[j] )
-								cutout[i] = 0;
-				}
-		int ID = omp_get_thread_num();
-		printf("THREAD ID: %d",ID);
-		}
+  int block, i;
+  uint32_t * eyt = NULL;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( listsize <= 0 )
+  {
+    memset ( cutout, 0, (size_t)cutoutsize * sizeof(uint32_t) );
+    return;
+  }
+
+  /* Page align the search structure */
+  if ( posix_memalign ( (void**)&eyt, ALIGNMENT, (size_t)listsize * sizeof(uint32_t) ) != 0 )
+    eyt = NULL;
+
+  if ( eyt != NULL )
+    eytzingerBuild32 ( filterlist, eyt, listsize, 0, 0 );
+
+  int nblocks = ( cutoutsize + BLOCKSIZE - 1 ) / BLOCKSIZE;
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) private(block,i) schedule(dynamic)
+  for ( block=0; block<nblocks; block++ )
+  {
+    int begin = block * BLOCKSIZE;
+    int end = begin + BLOCKSIZE;
+    if ( end > cutoutsize )
+      end = cutoutsize;
+
+    if ( eyt != NULL )
+    {
+      for ( i=begin; i<end; i++ )
+        if ( !eytzingerContains32 ( eyt, listsize, cutout[i] ) )
+          cutout[i] = 0;
+    }
+    else
+    {
+      /* allocation failed, scan the sorted list directly */
+      for ( i=begin; i<end; i++ )
+      {
+        bool equal = false;
+        int j;
+        for ( j=0; j<listsize; j++ )
+          if ( cutout[i] == filterlist[j] )
+          {
+            equal = true;
+            break;
+          }
+        if ( !equal )
+          cutout[i] = 0;
+      }
+    }
+  }
+
+  free ( eyt );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_FILTER, cutoutsize );
+}
+
+void filterCutoutOMPCache64 ( uint64_t * cutout, int cutoutsize, uint64_t * filterlist, int listsize )
+{
+  int block, i;
+  uint64_t * eyt = NULL;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( listsize <= 0 )
+  {
+    memset ( cutout, 0, (size_t)cutoutsize * sizeof(uint64_t) );
+    return;
+  }
+
+  /* Page align the search structure */
+  if ( posix_memalign ( (void**)&eyt, ALIGNMENT, (size_t)listsize * sizeof(uint64_t) ) != 0 )
+    eyt = NULL;
+
+  if ( eyt != NULL )
+    eytzingerBuild64 ( filterlist, eyt, listsize, 0, 0 );
+
+  int nblocks = ( cutoutsize + BLOCKSIZE - 1 ) / BLOCKSIZE;
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) private(block,i) schedule(dynamic)
+  for ( block=0; block<nblocks; block++ )
+  {
+    int begin = block * BLOCKSIZE;
+    int end = begin + BLOCKSIZE;
+    if ( end > cutoutsize )
+      end = cutoutsize;
+
+    if ( eyt != NULL )
+    {
+      for ( i=begin; i<end; i++ )
+        if ( !eytzingerContains64 ( eyt, listsize, cutout[i] ) )
+          cutout[i] = 0;
+    }
+    else
+    {
+      /* allocation failed, scan the sorted list directly */
+      for ( i=begin; i<end; i++ )
+      {
+        bool equal = false;
+        int j;
+        for ( j=0; j<listsize; j++ )
+          if ( cutout[i] == filterlist[j] )
+          {
+            equal = true;
+            break;
+          }
+        if ( !equal )
+          cutout[i] = 0;
+      }
+    }
+  }
+
+  free ( eyt );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_FILTER, cutoutsize );
 }
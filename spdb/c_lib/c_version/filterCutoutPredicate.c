@@ -0,0 +1,107 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Predicate filterCutout variants
+ *
+ * Filter lists that arrive as contiguous id ranges (reserve_ids blocks)
+ * or as dense id universes don't need the per-voxel list scan the other
+ * filterCutout implementations do. The range variant is one compare
+ * pair per voxel and vectorizes into packed compares; the bitmap
+ * variant is one bit test per voxel against a caller-built membership
+ * bitmap (one bit per id up to maxId), which stays cache-resident for
+ * id universes far larger than any sorted filter list would.
+ */
+
+#include<stdint.h>
+#include<omp.h>
+
+#define GEN_FILTER_RANGE( NAME, TYPE )                                    \
+void NAME ( TYPE * cutout, int cutoutsize, TYPE lo, TYPE hi )             \
+{                                                                         \
+    int i;                                                                \
+                                                                          \
+    _Pragma ( "omp parallel for simd num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<cutoutsize; i++ )                                        \
+    {                                                                     \
+      TYPE v = cutout[i];                                                 \
+      cutout[i] = ( v < lo || v > hi ) ? 0 : v;                           \
+    }                                                                     \
+}
+
+GEN_FILTER_RANGE ( filterCutoutRange32, uint32_t )
+GEN_FILTER_RANGE ( filterCutoutRange64, uint64_t )
+
+#define GEN_FILTER_BITMAP( NAME, TYPE )                                   \
+void NAME ( TYPE * cutout, int cutoutsize, uint8_t * bitmap, TYPE maxId ) \
+{                                                                         \
+    int i;                                                                \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<cutoutsize; i++ )                                        \
+    {                                                                     \
+      TYPE v = cutout[i];                                                 \
+      if ( v > maxId || !( bitmap[v >> 3] & ( 1 << ( v & 7 ) ) ) )        \
+        cutout[i] = 0;                                                    \
+    }                                                                     \
+}
+
+GEN_FILTER_BITMAP ( filterCutoutBitmap32, uint32_t )
+GEN_FILTER_BITMAP ( filterCutoutBitmap64, uint64_t )
+
+// 4D variant: filters every time sample of a (t, z, y, x) cuboid in one
+// call instead of one ctypes crossing and OMP region per sample. The
+// work is split over t*z slabs so short time series still fill the
+// thread pool. tstride is the voxel stride between samples (the sample
+// size when contiguous), dims are the per-sample [z, y, x] extents, and
+// the sorted filter list is probed by binary search per voxel.
+#define GEN_FILTER_4D( NAME, TYPE )                                       \
+void NAME ( TYPE * cutout, int timeSamples, int64_t tstride, int * dims,  \
+            TYPE * filterlist, int listsize )                             \
+{                                                                         \
+    int64_t s;                                                            \
+    int zdim = dims[0];                                                   \
+    int64_t slabSize = (int64_t)dims[1] * dims[2];                        \
+    int64_t nSlabs = (int64_t)timeSamples * zdim;                         \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)" ) \
+    for ( s=0; s<nSlabs; s++ )                                            \
+    {                                                                     \
+      TYPE * slab = cutout + ( s / zdim ) * tstride + ( s % zdim ) * slabSize; \
+      int64_t i;                                                          \
+                                                                          \
+      for ( i=0; i<slabSize; i++ )                                        \
+      {                                                                   \
+        TYPE v = slab[i];                                                 \
+        int lo = 0, hi = listsize - 1, found = 0;                         \
+                                                                          \
+        while ( lo <= hi )                                                \
+        {                                                                 \
+          int mid = lo + ( hi - lo ) / 2;                                 \
+          if ( filterlist[mid] == v ) { found = 1; break; }               \
+          else if ( filterlist[mid] < v ) lo = mid + 1;                   \
+          else hi = mid - 1;                                              \
+        }                                                                 \
+                                                                          \
+        if ( !found )                                                     \
+          slab[i] = 0;                                                    \
+      }                                                                   \
+    }                                                                     \
+}
+
+GEN_FILTER_4D ( filterCutoutOMP4D32, uint32_t )
+GEN_FILTER_4D ( filterCutoutOMP4D64, uint64_t )
@@ -0,0 +1,419 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Set-membership filter engine
+ *
+ * Replaces the per-voxel linear scan of the filter list in
+ * filterCutoutOMP32/64 with one of two cache-resident structures built
+ * once per call from the (sorted) filter list:
+ *
+ *   - a bitset over [min id, max id] when that span fits in cache, giving
+ *     an O(1) branch-free test per voxel (AVX-512 or AVX2 gather when
+ *     available, chosen at run time from ndlibCpuFeatures)
+ *   - a branch-free binary search over the sorted list otherwise
+ *
+ * The OpenMP outer parallelism of the original kernels is kept.
+ */
+
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include<omp.h>
+#include<stdbool.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include<immintrin.h>
+#endif
+#include<ndlib.h>
+
+/* Largest id span (in bits) for which the bitset structure is used.
+ * 1<<23 bits = 1 MB, sized to stay resident in a typical L2 cache. */
+#define BITSET_MAX_SPAN (1UL<<23)
+
+/* Branch-free membership test against the sorted filter list */
+
+static inline bool searchContains64 ( const uint64_t * list, int listsize, uint64_t key )
+{
+  const uint64_t * base = list;
+  int n = listsize;
+
+  while ( n > 1 )
+  {
+    int half = n / 2;
+    base += ( base[half-1] < key ) ? half : 0;
+    n -= half;
+  }
+
+  return ( base[0] == key );
+}
+
+static inline bool searchContains32 ( const uint32_t * list, int listsize, uint32_t key )
+{
+  const uint32_t * base = list;
+  int n = listsize;
+
+  while ( n > 1 )
+  {
+    int half = n / 2;
+    base += ( base[half-1] < key ) ? half : 0;
+    n -= half;
+  }
+
+  return ( base[0] == key );
+}
+
+#if defined(__x86_64__)
+
+/* AVX2 bitset test: 8 voxels per iteration via gathered bitset words */
+
+__attribute__((target("avx2")))
+static void filterBitsetAVX2_32 ( uint32_t * cutout, int cutoutsize, const uint32_t * bits, uint32_t minid, uint32_t span )
+{
+  int i;
+  uint32_t maxword = span >> 5;
+
+  __m256i vmin = _mm256_set1_epi32 ( (int)minid );
+  __m256i vspan = _mm256_set1_epi32 ( (int)span );
+  __m256i vmaxword = _mm256_set1_epi32 ( (int)maxword );
+  __m256i vone = _mm256_set1_epi32 ( 1 );
+  __m256i vmask5 = _mm256_set1_epi32 ( 31 );
+
+  for ( i=0; i+8<=cutoutsize; i+=8 )
+  {
+    __m256i v = _mm256_loadu_si256 ( (const __m256i*)(cutout+i) );
+    __m256i rel = _mm256_sub_epi32 ( v, vmin );
+
+    /* unsigned rel <= span via min_epu32 */
+    __m256i inrange = _mm256_cmpeq_epi32 ( _mm256_min_epu32 ( rel, vspan ), rel );
+
+    /* clamp word index so out-of-range lanes gather in bounds */
+    __m256i wordidx = _mm256_min_epu32 ( _mm256_srli_epi32 ( rel, 5 ), vmaxword );
+    __m256i words = _mm256_i32gather_epi32 ( (const int*)bits, wordidx, 4 );
+
+    __m256i bit = _mm256_and_si256 ( rel, vmask5 );
+    __m256i test = _mm256_and_si256 ( _mm256_srlv_epi32 ( words, bit ), vone );
+    __m256i keep = _mm256_and_si256 ( _mm256_cmpeq_epi32 ( test, vone ), inrange );
+
+    _mm256_storeu_si256 ( (__m256i*)(cutout+i), _mm256_and_si256 ( v, keep ) );
+  }
+
+  for ( ; i<cutoutsize; i++ )
+  {
+    uint32_t rel = cutout[i] - minid;
+    if ( rel > span || !( (bits[rel>>5] >> (rel&31)) & 1 ) )
+      cutout[i] = 0;
+  }
+}
+
+__attribute__((target("avx2")))
+static void filterBitsetAVX2_64 ( uint64_t * cutout, int cutoutsize, const uint32_t * bits, uint64_t minid, uint64_t span )
+{
+  int i;
+  uint64_t maxword = span >> 5;
+
+  __m256i vmin = _mm256_set1_epi64x ( (long long)minid );
+  __m256i vmaxword = _mm256_set1_epi64x ( (long long)maxword );
+  __m256i vone = _mm256_set1_epi64x ( 1 );
+  __m256i vmask5 = _mm256_set1_epi64x ( 31 );
+  __m256i vsign = _mm256_set1_epi64x ( (long long)0x8000000000000000ULL );
+  __m256i vspanbias = _mm256_set1_epi64x ( (long long)(span ^ 0x8000000000000000ULL) );
+
+  for ( i=0; i+4<=cutoutsize; i+=4 )
+  {
+    __m256i v = _mm256_loadu_si256 ( (const __m256i*)(cutout+i) );
+    __m256i rel = _mm256_sub_epi64 ( v, vmin );
+
+    /* unsigned rel <= span: bias both by the sign bit and compare signed */
+    __m256i relbias = _mm256_xor_si256 ( rel, vsign );
+    __m256i inrange = _mm256_xor_si256 ( _mm256_cmpgt_epi64 ( relbias, vspanbias ), _mm256_set1_epi64x ( -1 ) );
+
+    /* clamp word index so out-of-range lanes gather in bounds */
+    __m256i wordidx = _mm256_srli_epi64 ( rel, 5 );
+    __m256i clampmask = _mm256_xor_si256 ( _mm256_cmpgt_epi64 ( _mm256_xor_si256 ( wordidx, vsign ), _mm256_xor_si256 ( vmaxword, vsign ) ), _mm256_set1_epi64x ( -1 ) );
+    wordidx = _mm256_or_si256 ( _mm256_and_si256 ( wordidx, clampmask ), _mm256_andnot_si256 ( clampmask, vmaxword ) );
+
+    __m256i words = _mm256_i64gather_epi64 ( (const long long*)bits, wordidx, 4 );
+
+    /* gathered 8 bytes starting at the 4-byte word; bit index stays < 32 */
+    __m256i bit = _mm256_and_si256 ( rel, vmask5 );
+    __m256i test = _mm256_and_si256 ( _mm256_srlv_epi64 ( words, bit ), vone );
+    __m256i keep = _mm256_and_si256 ( _mm256_cmpeq_epi64 ( test, vone ), inrange );
+
+    _mm256_storeu_si256 ( (__m256i*)(cutout+i), _mm256_and_si256 ( v, keep ) );
+  }
+
+  for ( ; i<cutoutsize; i++ )
+  {
+    uint64_t rel = cutout[i] - minid;
+    if ( rel > span || !( (bits[rel>>5] >> (rel&31)) & 1 ) )
+      cutout[i] = 0;
+  }
+}
+
+/* AVX-512 bitset test: 16 (32-bit) or 8 (64-bit) voxels per iteration;
+ * the predicated lanes of AVX-512 replace the blend arithmetic of the
+ * AVX2 bodies with mask registers */
+
+__attribute__((target("avx512f")))
+static void filterBitsetAVX512_32 ( uint32_t * cutout, int cutoutsize, const uint32_t * bits, uint32_t minid, uint32_t span )
+{
+  int i;
+  uint32_t maxword = span >> 5;
+
+  __m512i vmin = _mm512_set1_epi32 ( (int)minid );
+  __m512i vspan = _mm512_set1_epi32 ( (int)span );
+  __m512i vmaxword = _mm512_set1_epi32 ( (int)maxword );
+  __m512i vone = _mm512_set1_epi32 ( 1 );
+  __m512i vmask5 = _mm512_set1_epi32 ( 31 );
+
+  for ( i=0; i+16<=cutoutsize; i+=16 )
+  {
+    __m512i v = _mm512_loadu_si512 ( (const void*)(cutout+i) );
+    __m512i rel = _mm512_sub_epi32 ( v, vmin );
+
+    __mmask16 inrange = _mm512_cmple_epu32_mask ( rel, vspan );
+
+    /* clamp word index so out-of-range lanes gather in bounds */
+    __m512i wordidx = _mm512_min_epu32 ( _mm512_srli_epi32 ( rel, 5 ), vmaxword );
+    __m512i words = _mm512_i32gather_epi32 ( wordidx, (const void*)bits, 4 );
+
+    __m512i bit = _mm512_and_si512 ( rel, vmask5 );
+    __m512i test = _mm512_and_si512 ( _mm512_srlv_epi32 ( words, bit ), vone );
+    __mmask16 keep = _mm512_cmpeq_epi32_mask ( test, vone ) & inrange;
+
+    _mm512_storeu_si512 ( (void*)(cutout+i), _mm512_maskz_mov_epi32 ( keep, v ) );
+  }
+
+  for ( ; i<cutoutsize; i++ )
+  {
+    uint32_t rel = cutout[i] - minid;
+    if ( rel > span || !( (bits[rel>>5] >> (rel&31)) & 1 ) )
+      cutout[i] = 0;
+  }
+}
+
+__attribute__((target("avx512f")))
+static void filterBitsetAVX512_64 ( uint64_t * cutout, int cutoutsize, const uint32_t * bits, uint64_t minid, uint64_t span )
+{
+  int i;
+  uint64_t maxword = span >> 5;
+
+  __m512i vmin = _mm512_set1_epi64 ( (long long)minid );
+  __m512i vspan = _mm512_set1_epi64 ( (long long)span );
+  __m512i vmaxword = _mm512_set1_epi64 ( (long long)maxword );
+  __m512i vone = _mm512_set1_epi64 ( 1 );
+  __m512i vmask5 = _mm512_set1_epi64 ( 31 );
+
+  for ( i=0; i+8<=cutoutsize; i+=8 )
+  {
+    __m512i v = _mm512_loadu_si512 ( (const void*)(cutout+i) );
+    __m512i rel = _mm512_sub_epi64 ( v, vmin );
+
+    __mmask8 inrange = _mm512_cmple_epu64_mask ( rel, vspan );
+
+    /* clamp word index so out-of-range lanes gather in bounds */
+    __m512i wordidx = _mm512_min_epu64 ( _mm512_srli_epi64 ( rel, 5 ), vmaxword );
+
+    /* gathered 8 bytes starting at the 4-byte word; bit index stays < 32 */
+    __m512i words = _mm512_i64gather_epi64 ( wordidx, (const void*)bits, 4 );
+
+    __m512i bit = _mm512_and_si512 ( rel, vmask5 );
+    __m512i test = _mm512_and_si512 ( _mm512_srlv_epi64 ( words, bit ), vone );
+    __mmask8 keep = _mm512_cmpeq_epi64_mask ( test, vone ) & inrange;
+
+    _mm512_storeu_si512 ( (void*)(cutout+i), _mm512_maskz_mov_epi64 ( keep, v ) );
+  }
+
+  for ( ; i<cutoutsize; i++ )
+  {
+    uint64_t rel = cutout[i] - minid;
+    if ( rel > span || !( (bits[rel>>5] >> (rel&31)) & 1 ) )
+      cutout[i] = 0;
+  }
+}
+
+#endif /* __x86_64__ */
+
+static void filterBitset32 ( uint32_t * cutout, int cutoutsize, const uint32_t * bits, uint32_t minid, uint32_t span )
+{
+  int i;
+  for ( i=0; i<cutoutsize; i++ )
+  {
+    uint32_t rel = cutout[i] - minid;
+    if ( rel > span || !( (bits[rel>>5] >> (rel&31)) & 1 ) )
+      cutout[i] = 0;
+  }
+}
+
+static void filterBitset64 ( uint64_t * cutout, int cutoutsize, const uint32_t * bits, uint64_t minid, uint64_t span )
+{
+  int i;
+  for ( i=0; i<cutoutsize; i++ )
+  {
+    uint64_t rel = cutout[i] - minid;
+    if ( rel > span || !( (bits[rel>>5] >> (rel&31)) & 1 ) )
+      cutout[i] = 0;
+  }
+}
+
+/* Build the bitset over [min id, max id] from a sorted filter list.
+ * Returns NULL when the span is too large to stay cache resident. */
+
+static uint32_t * buildBitset64 ( const uint64_t * filterlist, int listsize, uint64_t * minid, uint64_t * span )
+{
+  uint32_t * bits;
+  int i;
+
+  *minid = filterlist[0];
+  *span = filterlist[listsize-1] - filterlist[0];
+
+  if ( *span >= BITSET_MAX_SPAN )
+    return NULL;
+
+  /* one extra word so an 8-byte gather at the last word stays in bounds */
+  size_t nwords = (*span >> 5) + 2;
+  bits = calloc ( nwords, sizeof(uint32_t) );
+  if ( bits == NULL )
+    return NULL;
+
+  for ( i=0; i<listsize; i++ )
+  {
+    uint64_t rel = filterlist[i] - *minid;
+    bits[rel>>5] |= 1U << (rel&31);
+  }
+
+  return bits;
+}
+
+void filterCutoutSIMD32 ( uint32_t * cutout, int cutoutsize, uint32_t * filterlist, int listsize )
+{
+  int i;
+  uint64_t minid, span;
+  uint32_t * bits;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( listsize <= 0 )
+  {
+    memset ( cutout, 0, (size_t)cutoutsize * sizeof(uint32_t) );
+    return;
+  }
+
+  minid = filterlist[0];
+  span = (uint64_t)filterlist[listsize-1] - filterlist[0];
+
+  bits = NULL;
+  if ( span < BITSET_MAX_SPAN )
+  {
+    size_t nwords = (span >> 5) + 2;
+    bits = calloc ( nwords, sizeof(uint32_t) );
+    if ( bits != NULL )
+      for ( i=0; i<listsize; i++ )
+      {
+        uint32_t rel = filterlist[i] - (uint32_t)minid;
+        bits[rel>>5] |= 1U << (rel&31);
+      }
+  }
+
+#pragma omp parallel num_threads(omp_get_max_threads())
+  {
+    int nthreads = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    int chunk = ( cutoutsize + nthreads - 1 ) / nthreads;
+    int begin = tid * chunk;
+    int end = begin + chunk;
+    if ( end > cutoutsize )
+      end = cutoutsize;
+
+    if ( begin < end )
+    {
+      if ( bits != NULL )
+      {
+#if defined(__x86_64__)
+        int cpu = ndlibCpuFeatures ();
+        if ( cpu & NDLIB_CPU_AVX512F )
+          filterBitsetAVX512_32 ( cutout+begin, end-begin, bits, (uint32_t)minid, (uint32_t)span );
+        else if ( cpu & NDLIB_CPU_AVX2 )
+          filterBitsetAVX2_32 ( cutout+begin, end-begin, bits, (uint32_t)minid, (uint32_t)span );
+        else
+#endif
+          filterBitset32 ( cutout+begin, end-begin, bits, (uint32_t)minid, (uint32_t)span );
+      }
+      else
+      {
+        int k;
+        for ( k=begin; k<end; k++ )
+          if ( !searchContains32 ( filterlist, listsize, cutout[k] ) )
+            cutout[k] = 0;
+      }
+    }
+  }
+
+  free ( bits );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_FILTER, cutoutsize );
+}
+
+void filterCutoutSIMD64 ( uint64_t * cutout, int cutoutsize, uint64_t * filterlist, int listsize )
+{
+  uint64_t minid, span;
+  uint32_t * bits;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( listsize <= 0 )
+  {
+    memset ( cutout, 0, (size_t)cutoutsize * sizeof(uint64_t) );
+    return;
+  }
+
+  bits = buildBitset64 ( filterlist, listsize, &minid, &span );
+
+#pragma omp parallel num_threads(omp_get_max_threads())
+  {
+    int nthreads = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    int chunk = ( cutoutsize + nthreads - 1 ) / nthreads;
+    int begin = tid * chunk;
+    int end = begin + chunk;
+    if ( end > cutoutsize )
+      end = cutoutsize;
+
+    if ( begin < end )
+    {
+      if ( bits != NULL )
+      {
+#if defined(__x86_64__)
+        int cpu = ndlibCpuFeatures ();
+        if ( cpu & NDLIB_CPU_AVX512F )
+          filterBitsetAVX512_64 ( cutout+begin, end-begin, bits, minid, span );
+        else if ( cpu & NDLIB_CPU_AVX2 )
+          filterBitsetAVX2_64 ( cutout+begin, end-begin, bits, minid, span );
+        else
+#endif
+          filterBitset64 ( cutout+begin, end-begin, bits, minid, span );
+      }
+      else
+      {
+        int k;
+        for ( k=begin; k<end; k++ )
+          if ( !searchContains64 ( filterlist, listsize, cutout[k] ) )
+            cutout[k] = 0;
+      }
+    }
+  }
+
+  free ( bits );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_FILTER, cutoutsize );
+}
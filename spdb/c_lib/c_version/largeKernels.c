@@ -0,0 +1,153 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Large-cuboid (64-bit size) kernel variants
+ *
+ * The legacy kernel signatures take int sizes and compute int indices,
+ * which overflows past 2^31 voxels and blocks larger cuboid
+ * configurations (1024x1024x64 uint64 time series). The L-suffixed
+ * variants here take int64_t extents and index in size_t throughout;
+ * the old entry points are unchanged for compatibility. The addData
+ * OMP kernels already index in size_t with per-axis int extents (an
+ * axis cannot overflow int on its own), so their L variants only
+ * narrow the extents before delegating; uniqueOMPL delegates to the
+ * chunked idsInRegionOMP scan, which is 64-bit clean by construction.
+ */
+
+#include<stdint.h>
+#include<stddef.h>
+#include<math.h>
+#include<omp.h>
+#include<ndlib.h>
+
+#define GEN_OVERWRITE_DENSE_L( NAME, TYPE )                               \
+void NAME ( TYPE * data, TYPE * annodata, int64_t * dims )                \
+{                                                                         \
+    int64_t i;                                                            \
+    int64_t n = dims[0] * dims[1] * dims[2];                              \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<n; i++ )                                                 \
+      if ( annodata[i] != 0 )                                             \
+        data[i] = annodata[i];                                            \
+}
+
+GEN_OVERWRITE_DENSE_L ( overwriteDenseL, uint32_t )
+GEN_OVERWRITE_DENSE_L ( overwriteDense8L, uint8_t )
+GEN_OVERWRITE_DENSE_L ( overwriteDense16L, uint16_t )
+GEN_OVERWRITE_DENSE_L ( overwriteDense64L, uint64_t )
+
+// The filter list arrives sorted (the python wrappers sort it for the
+// bitset kernels already), so membership is a binary search per voxel
+#define GEN_FILTER_CUTOUT_L( NAME, TYPE )                                 \
+void NAME ( TYPE * cutout, int64_t cutoutsize, TYPE * filterlist, int listsize ) \
+{                                                                         \
+    int64_t i;                                                            \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<cutoutsize; i++ )                                        \
+    {                                                                     \
+      TYPE v = cutout[i];                                                 \
+      int lo = 0, hi = listsize - 1, found = 0;                           \
+                                                                          \
+      while ( lo <= hi )                                                  \
+      {                                                                   \
+        int mid = lo + ( hi - lo ) / 2;                                   \
+        if ( filterlist[mid] == v ) { found = 1; break; }                 \
+        else if ( filterlist[mid] < v ) lo = mid + 1;                     \
+        else hi = mid - 1;                                                \
+      }                                                                   \
+                                                                          \
+      if ( !found )                                                       \
+        cutout[i] = 0;                                                    \
+    }                                                                     \
+}
+
+GEN_FILTER_CUTOUT_L ( filterCutoutOMP32L, uint32_t )
+GEN_FILTER_CUTOUT_L ( filterCutoutOMP64L, uint64_t )
+
+// Zoom out, size_t index math; dims are the new (downsampled) extents
+void zoomOutDataOMPL ( uint32_t * olddata, uint32_t * newdata, int64_t * dims, int factor )
+{
+    int64_t i, j, k;
+
+    int64_t zdim = dims[0];
+    int64_t ydim = dims[1];
+    int64_t xdim = dims[2];
+
+    int64_t power = 1LL << factor;
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) private(j,k) schedule(dynamic)
+    for ( i=0; i<zdim; i++ )
+      for ( j=0; j<ydim; j++ )
+        for ( k=0; k<xdim; k++ )
+        {
+          size_t newindex = ((size_t)i*xdim*ydim)+((size_t)j*xdim)+(k);
+          size_t oldindex = ( (size_t)i*(xdim*power)*(ydim*power) ) + ( (size_t)(j*power)*(xdim*power) ) + ( k*power );
+          newdata[newindex] = olddata[oldindex];
+        }
+}
+
+// Zoom in, size_t index math; dims are the new (upsampled) extents
+void zoomInDataOMPL ( uint32_t * olddata, uint32_t * newdata, int64_t * dims, int factor )
+{
+    int64_t i, j, k;
+
+    int64_t zdim = dims[0];
+    int64_t ydim = dims[1];
+    int64_t xdim = dims[2];
+
+    int64_t power = 1LL << factor;
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) private(j,k) schedule(dynamic)
+    for ( i=0; i<zdim; i++ )
+      for ( j=0; j<ydim; j++ )
+        for ( k=0; k<xdim; k++ )
+        {
+          size_t newindex = ((size_t)i*xdim*ydim)+((size_t)j*xdim)+(k);
+          size_t oldindex = ( (size_t)i*(xdim/power)*(ydim/power) ) + ( (size_t)(j/power)*(xdim/power) ) + ( k/power );
+          newdata[newindex] = olddata[oldindex];
+        }
+}
+
+// addData L variants: the OMP kernels already index in size_t, so only
+// the extents need narrowing (no axis can exceed int on its own)
+#define GEN_ADD_DATA_L( NAME, TYPE, DELEGATE )                            \
+void NAME ( TYPE * cube, TYPE * output, int64_t * offset, int64_t * dims, \
+            int64_t * outdims, int factor )                               \
+{                                                                         \
+    int off32[3] = { (int)offset[0], (int)offset[1], (int)offset[2] };    \
+    int dims32[3] = { (int)dims[0], (int)dims[1], (int)dims[2] };         \
+    int out32[3] = { (int)outdims[0], (int)outdims[1], (int)outdims[2] }; \
+                                                                          \
+    DELEGATE ( cube, output, off32, dims32, out32, factor );              \
+}
+
+GEN_ADD_DATA_L ( addDataZSliceOMPL, uint32_t, addDataZSliceOMP )
+GEN_ADD_DATA_L ( addDataZSliceOMPL64, uint64_t, addDataZSliceOMP64 )
+GEN_ADD_DATA_L ( addDataIsotropicOMPL, uint32_t, addDataIsotropicOMP )
+GEN_ADD_DATA_L ( addDataIsotropicOMPL64, uint64_t, addDataIsotropicOMP64 )
+
+// Distinct nonzero ids of an arbitrarily large cuboid; delegates to the
+// chunked region scan, which is 64-bit clean by construction
+int uniqueOMPL ( uint64_t * data, uint64_t * ids, int64_t n, int maxIds )
+{
+    uint64_t * cuboids[1] = { data };
+
+    return idsInRegionOMP ( cuboids, 1, n, maxIds, ids );
+}
@@ -25,6 +25,8 @@
 #include<stdbool.h>
 #include<stdlib.h>
 #include<string.h>
+#include<omp.h>
+#include<ndlib.h>
 
 void locateCube( uint64_t locs[][4], int locsSize, uint32_t locations[][3], int locationsSize, int * dims )
 {
@@ -51,3 +53,166 @@ void locateCube( uint64_t locs[][4], int locsSize, uint32_t locations[][3], int
 		}
     
 }
+
+/*
+ * Fused locate + sort
+ *
+ * Computes the [morton, x, y, z] rows of locateCube and sorts them in the
+ * same call with an OpenMP LSD radix sort, replacing the separate
+ * locateCube + quicksort passes and the 32-byte comparator callback.
+ * Keys are kept as struct-of-arrays (morton array + the caller's
+ * locations array) and only a 4-byte index permutation is scattered per
+ * pass; rows are materialized once at the end. Sort order matches
+ * quicksort's cmpFunc: morton, then x, then y, then z. Byte passes where
+ * every key agrees (the high bytes of most coordinate sets) are skipped.
+ */
+
+// Byte extraction for the LSD pass sequence: z, y, x, then morton
+
+static inline uint32_t locByte ( const uint64_t * morton, uint32_t locations[][3], uint32_t row, int pass )
+{
+  if ( pass < 4 )
+    return ( locations[row][2] >> (pass*8) ) & 0xFF;
+  if ( pass < 8 )
+    return ( locations[row][1] >> ((pass-4)*8) ) & 0xFF;
+  if ( pass < 12 )
+    return ( locations[row][0] >> ((pass-8)*8) ) & 0xFF;
+  return ( morton[row] >> ((pass-12)*8) ) & 0xFF;
+}
+
+void locateAndSortCube( uint64_t locs[][4], int locsSize, uint32_t locations[][3], int locationsSize, int * dims )
+{
+  int i, pass, t, b;
+  NDLIB_STAT_START ( statT0 );
+
+  int xdim = dims[0];
+  int ydim = dims[1];
+  int zdim = dims[2];
+
+  if ( locationsSize <= 0 )
+    return;
+
+  uint64_t * morton = malloc ( (size_t)locationsSize * sizeof(uint64_t) );
+  uint32_t * idx = malloc ( (size_t)locationsSize * sizeof(uint32_t) );
+  uint32_t * idx2 = malloc ( (size_t)locationsSize * sizeof(uint32_t) );
+
+  if ( morton == NULL || idx == NULL || idx2 == NULL )
+  {
+    // fall back to the separate passes
+    free ( morton );
+    free ( idx );
+    free ( idx2 );
+    locateCube ( locs, locsSize, locations, locationsSize, dims );
+    quicksort ( locs, locationsSize );
+    return;
+  }
+
+  int nthreads = omp_get_max_threads();
+  if ( nthreads > locationsSize )
+    nthreads = 1;
+  int chunk = ( locationsSize + nthreads - 1 ) / nthreads;
+
+  // compute the morton key of each location's cuboid
+#pragma omp parallel for num_threads(nthreads) private(i) schedule(static)
+  for ( i=0; i<locationsSize; i++ )
+  {
+    uint64_t cubeno[3];
+    cubeno[0] = locations[i][0]/xdim;
+    cubeno[1] = locations[i][1]/ydim;
+    cubeno[2] = locations[i][2]/zdim;
+    morton[i] = XYZMorton ( cubeno );
+    idx[i] = i;
+  }
+
+  size_t * histogram = malloc ( (size_t)nthreads * 256 * sizeof(size_t) );
+  if ( histogram == NULL )
+  {
+    free ( morton );
+    free ( idx );
+    free ( idx2 );
+    locateCube ( locs, locsSize, locations, locationsSize, dims );
+    quicksort ( locs, locationsSize );
+    return;
+  }
+
+  // 4 byte passes each over z, y, x, then 8 over the morton key
+  for ( pass=0; pass<20; pass++ )
+  {
+    memset ( histogram, 0, (size_t)nthreads * 256 * sizeof(size_t) );
+
+#pragma omp parallel num_threads(nthreads) private(i)
+    {
+      int tid = omp_get_thread_num();
+      size_t * local = histogram + (size_t)tid * 256;
+      int begin = tid * chunk;
+      int end = begin + chunk;
+      if ( end > locationsSize )
+        end = locationsSize;
+
+      for ( i=begin; i<end; i++ )
+        local[ locByte ( morton, locations, idx[i], pass ) ] += 1;
+    }
+
+    // skip the pass when every key lands in one bucket
+    int trivial = 0;
+    for ( b=0; b<256; b++ )
+    {
+      size_t total = 0;
+      for ( t=0; t<nthreads; t++ )
+        total += histogram[ (size_t)t * 256 + b ];
+      if ( total == (size_t)locationsSize )
+      {
+        trivial = 1;
+        break;
+      }
+      if ( total > 0 )
+        break;
+    }
+    if ( trivial )
+      continue;
+
+    // prefix sum bucket-major so each thread owns a stable slice
+    size_t offset = 0;
+    for ( b=0; b<256; b++ )
+      for ( t=0; t<nthreads; t++ )
+      {
+        size_t count = histogram[ (size_t)t * 256 + b ];
+        histogram[ (size_t)t * 256 + b ] = offset;
+        offset += count;
+      }
+
+#pragma omp parallel num_threads(nthreads) private(i)
+    {
+      int tid = omp_get_thread_num();
+      size_t * local = histogram + (size_t)tid * 256;
+      int begin = tid * chunk;
+      int end = begin + chunk;
+      if ( end > locationsSize )
+        end = locationsSize;
+
+      for ( i=begin; i<end; i++ )
+        idx2[ local[ locByte ( morton, locations, idx[i], pass ) ]++ ] = idx[i];
+    }
+
+    uint32_t * tmp = idx;
+    idx = idx2;
+    idx2 = tmp;
+  }
+
+  // materialize the sorted rows once
+#pragma omp parallel for num_threads(nthreads) private(i) schedule(static)
+  for ( i=0; i<locationsSize; i++ )
+  {
+    uint32_t j = idx[i];
+    locs[i][0] = morton[j];
+    locs[i][1] = locations[j][0];
+    locs[i][2] = locations[j][1];
+    locs[i][3] = locations[j][2];
+  }
+
+  free ( histogram );
+  free ( morton );
+  free ( idx );
+  free ( idx2 );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_SORT, locationsSize );
+}
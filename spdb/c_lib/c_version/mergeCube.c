@@ -1,12 +1,12 @@
 /*
 * Copyright 2014 NeuroData (http://neurodata.io)
-* 
+*
 * Licensed under the Apache License, Version 2.0 (the "License");
 * you may not use this file except in compliance with the License.
 * You may obtain a copy of the License at
-* 
+*
 *     http://www.apache.org/licenses/LICENSE-2.0
-* 
+*
 * Unless required by applicable law or agreed to in writing, software
 * distributed under the License is distributed on an "AS IS" BASIS,
 * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -16,8 +16,8 @@
 
 
 /*
- * Merge Cube Function 
- * Naive implementation 
+ * Merge Cube Function
+ * Naive implementation, macro expanded for each supported voxel width
  */
 
 #include<stdio.h>
@@ -26,20 +26,151 @@
 #include<stdlib.h>
 #include<string.h>
 
-int mergeCube( uint32_t * data, int * dims, int newid, int oldid )
+#define GEN_MERGE_CUBE( NAME, TYPE, IDTYPE )                      \
+void NAME ( TYPE * data, int * dims, IDTYPE newid, IDTYPE oldid ) \
+{                                                                 \
+    int i,j,k,index;                                              \
+                                                                  \
+    int zdim = dims[0];                                           \
+    int ydim = dims[1];                                           \
+    int xdim = dims[2];                                           \
+                                                                  \
+    for ( k=0; k<zdim; k++ )                                      \
+      for ( j=0; j<ydim; j++ )                                    \
+        for ( i=0; i<xdim; i++ )                                  \
+        {                                                         \
+          index = (k*xdim*ydim) + (j*xdim) + (i);                 \
+          if ( data [index] == oldid )                            \
+            data [index] = newid;                                 \
+        }                                                         \
+}
+
+GEN_MERGE_CUBE ( mergeCube, uint32_t, int )   // Legacy entry point keeps its int ids
+GEN_MERGE_CUBE ( mergeCube8, uint8_t, uint8_t )
+GEN_MERGE_CUBE ( mergeCube16, uint16_t, uint16_t )
+GEN_MERGE_CUBE ( mergeCube64, uint64_t, uint64_t )
+
+/*
+ * Table-driven batch relabel engine
+ *
+ * Applies a whole table of oldid -> newid relabels in one OpenMP pass
+ * instead of one full-cube pass per pair, so merging an equivalence
+ * class of n fragments costs O(voxels) rather than O(voxels * n). The
+ * 8 and 16 bit widths build a direct lookup table over the full id
+ * universe; the 32 and 64 bit widths sort the pair table once and
+ * binary search it per voxel, with a min/max prescreen that rejects
+ * most voxels in one compare. Chained relabels (a -> b, b -> c) are
+ * applied in one step per voxel, so the caller resolves chains in the
+ * table if transitive merges are wanted. When the table scratch cannot
+ * be allocated the engine falls back to per-pair passes.
+ */
+
+#include<omp.h>
+
+#define GEN_MERGE_CUBE_BATCH_LUT( NAME, TYPE, UNIVERSE )                  \
+void NAME ( TYPE * data, int64_t n, TYPE * oldids, TYPE * newids,         \
+            int nPairs )                                                  \
+{                                                                         \
+    TYPE * lut = malloc ( (size_t)(UNIVERSE) * sizeof(TYPE) );            \
+    int64_t i;                                                            \
+    int p;                                                                \
+                                                                          \
+    if ( lut == NULL )                                                    \
+    {                                                                     \
+      for ( p=0; p<nPairs; p++ )                                          \
+        for ( i=0; i<n; i++ )                                             \
+          if ( data[i] == oldids[p] )                                     \
+            data[i] = newids[p];                                          \
+      return;                                                             \
+    }                                                                     \
+                                                                          \
+    for ( i=0; i<(UNIVERSE); i++ )                                        \
+      lut[i] = (TYPE)i;                                                   \
+    for ( p=0; p<nPairs; p++ )                                            \
+      lut[ oldids[p] ] = newids[p];                                       \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<n; i++ )                                                 \
+      data[i] = lut[ data[i] ];                                           \
+                                                                          \
+    free ( lut );                                                         \
+}
+
+GEN_MERGE_CUBE_BATCH_LUT ( mergeCubeBatch8, uint8_t, 256 )
+GEN_MERGE_CUBE_BATCH_LUT ( mergeCubeBatch16, uint16_t, 65536 )
+
+typedef struct { uint32_t oldid; uint32_t newid; } MergePair32;
+typedef struct { uint64_t oldid; uint64_t newid; } MergePair64;
+
+static int cmpMergePair32 ( const void * pa, const void * pb )
+{
+  uint32_t a = ((const MergePair32*)pa)->oldid;
+  uint32_t b = ((const MergePair32*)pb)->oldid;
+  return ( a > b ) - ( a < b );
+}
+
+static int cmpMergePair64 ( const void * pa, const void * pb )
 {
-		int i,j,k,index;
-
-    int zdim = dims[0];
-    int ydim = dims[1];
-    int xdim = dims[2];
-
-    for ( k=0; k<zdim; k++ )
-      for ( j=0; j<ydim; j++ )
-        for ( i=0; i<xdim; i++ )
-        {
-          index = (k*xdim*ydim) + (j*xdim) + (i);
-          if ( data [index] == oldid )
-            data [index] = newid;
-        }
+  uint64_t a = ((const MergePair64*)pa)->oldid;
+  uint64_t b = ((const MergePair64*)pb)->oldid;
+  return ( a > b ) - ( a < b );
+}
+
+#define GEN_MERGE_CUBE_BATCH_SEARCH( NAME, TYPE, PAIR, CMP )              \
+void NAME ( TYPE * data, int64_t n, TYPE * oldids, TYPE * newids,         \
+            int nPairs )                                                  \
+{                                                                         \
+    PAIR * pairs;                                                         \
+    int64_t i;                                                            \
+    int p;                                                                \
+                                                                          \
+    if ( nPairs <= 0 )                                                    \
+      return;                                                             \
+                                                                          \
+    pairs = malloc ( (size_t)nPairs * sizeof(PAIR) );                     \
+    if ( pairs == NULL )                                                  \
+    {                                                                     \
+      for ( p=0; p<nPairs; p++ )                                          \
+        for ( i=0; i<n; i++ )                                             \
+          if ( data[i] == oldids[p] )                                     \
+            data[i] = newids[p];                                          \
+      return;                                                             \
+    }                                                                     \
+                                                                          \
+    for ( p=0; p<nPairs; p++ )                                            \
+    {                                                                     \
+      pairs[p].oldid = oldids[p];                                         \
+      pairs[p].newid = newids[p];                                         \
+    }                                                                     \
+    qsort ( pairs, nPairs, sizeof(PAIR), CMP );                           \
+                                                                          \
+    TYPE minid = pairs[0].oldid;                                          \
+    TYPE maxid = pairs[nPairs-1].oldid;                                   \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( i=0; i<n; i++ )                                                 \
+    {                                                                     \
+      TYPE v = data[i];                                                   \
+      int lo = 0, hi = nPairs - 1;                                        \
+                                                                          \
+      if ( v < minid || v > maxid )                                       \
+        continue;                                                         \
+                                                                          \
+      while ( lo <= hi )                                                  \
+      {                                                                   \
+        int mid = lo + ( hi - lo ) / 2;                                   \
+        if ( pairs[mid].oldid == v )                                      \
+        {                                                                 \
+          data[i] = pairs[mid].newid;                                     \
+          break;                                                          \
+        }                                                                 \
+        else if ( pairs[mid].oldid < v ) lo = mid + 1;                    \
+        else hi = mid - 1;                                                \
+      }                                                                   \
+    }                                                                     \
+                                                                          \
+    free ( pairs );                                                       \
 }
+
+GEN_MERGE_CUBE_BATCH_SEARCH ( mergeCubeBatch, uint32_t, MergePair32, cmpMergePair32 )
+GEN_MERGE_CUBE_BATCH_SEARCH ( mergeCubeBatch64, uint64_t, MergePair64, cmpMergePair64 )
@@ -0,0 +1,266 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Morton-order (Z-curve) cube layout
+ *
+ * Relayout kernels between the row-major cuboid layout the rest of
+ * ndlib uses and a compact Z-curve layout where every 2x2x2
+ * neighborhood is 8 contiguous elements. Cube extents must be powers
+ * of two; for unequal extents (the usual anisotropic 512x512x16
+ * cuboid) the interleave is the compact form that round-robins only
+ * the axes that still have bits, so the index space stays dense. For
+ * equal extents this is exactly the XYZMorton bit order from zindex.c
+ * (x in the lowest bit).
+ *
+ * Per-axis bit-scatter code tables are built once per call (at most
+ * one entry per coordinate value) so the per-voxel work is three table
+ * lookups and an or, with PDEP building the tables on BMI2 parts.
+ */
+
+#include<stdint.h>
+#include<stddef.h>
+#include<stdlib.h>
+#include<string.h>
+#include<omp.h>
+#include<ndlib.h>
+
+#if defined(__x86_64__)
+#include<immintrin.h>
+
+// PDEP is picked through the shared ndlibCpuFeatures mask so the table
+// build honors the same dispatch (and overrides) as the other
+// multi-versioned kernels
+static int haveBMI2 ( void )
+{
+  return ( ndlibCpuFeatures () & NDLIB_CPU_BMI2 ) != 0;
+}
+
+__attribute__((target("bmi2")))
+static uint64_t spreadBitsBMI2 ( uint64_t value, uint64_t mask )
+{
+  return _pdep_u64 ( value, mask );
+}
+
+#endif
+
+// Scatter the low bits of value into the set bit positions of mask
+static uint64_t spreadBits ( uint64_t value, uint64_t mask )
+{
+  uint64_t result = 0;
+  uint64_t bit;
+
+#if defined(__x86_64__)
+  if ( haveBMI2 () )
+    return spreadBitsBMI2 ( value, mask );
+#endif
+
+  for ( bit=1; mask != 0; bit<<=1 )
+  {
+    uint64_t slot = mask & -mask;
+    if ( value & bit )
+      result |= slot;
+    mask ^= slot;
+  }
+
+  return result;
+}
+
+static int log2dim ( int dim )
+{
+  int bits = 0;
+  while ( ( 1 << bits ) < dim )
+    bits += 1;
+  return bits;
+}
+
+// Build the per-axis interleave masks for a (z, y, x) cube, x lowest
+static void mortonAxisMasks ( int * dims, uint64_t * maskx, uint64_t * masky, uint64_t * maskz )
+{
+  int bitsz = log2dim ( dims[0] );
+  int bitsy = log2dim ( dims[1] );
+  int bitsx = log2dim ( dims[2] );
+  int bit, pos = 0;
+
+  *maskx = *masky = *maskz = 0;
+  for ( bit=0; bit<bitsx || bit<bitsy || bit<bitsz; bit++ )
+  {
+    if ( bit < bitsx )
+      *maskx |= 1ULL << pos++;
+    if ( bit < bitsy )
+      *masky |= 1ULL << pos++;
+    if ( bit < bitsz )
+      *maskz |= 1ULL << pos++;
+  }
+}
+
+// Build the per-coordinate code tables; returns 0 on allocation failure
+static int mortonCodeTables ( int * dims, uint64_t ** zcode, uint64_t ** ycode, uint64_t ** xcode )
+{
+  uint64_t maskx, masky, maskz;
+  int i;
+
+  mortonAxisMasks ( dims, &maskx, &masky, &maskz );
+
+  *zcode = malloc ( dims[0] * sizeof(uint64_t) );
+  *ycode = malloc ( dims[1] * sizeof(uint64_t) );
+  *xcode = malloc ( dims[2] * sizeof(uint64_t) );
+  if ( *zcode == NULL || *ycode == NULL || *xcode == NULL )
+  {
+    free ( *zcode );
+    free ( *ycode );
+    free ( *xcode );
+    return 0;
+  }
+
+  for ( i=0; i<dims[0]; i++ )
+    (*zcode)[i] = spreadBits ( i, maskz );
+  for ( i=0; i<dims[1]; i++ )
+    (*ycode)[i] = spreadBits ( i, masky );
+  for ( i=0; i<dims[2]; i++ )
+    (*xcode)[i] = spreadBits ( i, maskx );
+
+  return 1;
+}
+
+// Per-width copy loops shared by both relayout directions; dir 0 is
+// row-major to morton, dir 1 is morton to row-major
+#define MORTON_RELAYOUT_LOOP( TYPE )                                          \
+do {                                                                          \
+  TYPE * s = ( TYPE * ) src;                                                  \
+  TYPE * d = ( TYPE * ) dst;                                                  \
+  if ( dir == 0 )                                                             \
+    for ( j=0; j<ydim; j++ )                                                  \
+      for ( k=0; k<xdim; k++ )                                                \
+        d[ zc | ycode[j] | xcode[k] ] = s[ row++ ];                           \
+  else                                                                        \
+    for ( j=0; j<ydim; j++ )                                                  \
+      for ( k=0; k<xdim; k++ )                                                \
+        d[ row++ ] = s[ zc | ycode[j] | xcode[k] ];                           \
+} while (0)
+
+static int mortonRelayout ( uint8_t * src, uint8_t * dst, int * dims, int voxelSize, int dir )
+{
+  int zdim = dims[0];
+  int ydim = dims[1];
+  int xdim = dims[2];
+  uint64_t * zcode, * ycode, * xcode;
+  int i;
+
+  if ( !mortonCodeTables ( dims, &zcode, &ycode, &xcode ) )
+  {
+    // table-free fallback: interleave per voxel with spreadBits. Slower,
+    // but needs no allocation, so the relayout still completes instead
+    // of handing back an untouched dst.
+    uint64_t maskx, masky, maskz;
+    mortonAxisMasks ( dims, &maskx, &masky, &maskz );
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)
+    for ( i=0; i<zdim; i++ )
+    {
+      int j, k;
+      uint64_t zc = spreadBits ( i, maskz );
+      size_t row = (size_t)i * ydim * xdim;
+
+      for ( j=0; j<ydim; j++ )
+      {
+        uint64_t yc = zc | spreadBits ( j, masky );
+        for ( k=0; k<xdim; k++, row++ )
+        {
+          size_t morton = yc | spreadBits ( k, maskx );
+          if ( dir == 0 )
+            memcpy ( dst + morton * voxelSize, src + row * voxelSize, voxelSize );
+          else
+            memcpy ( dst + row * voxelSize, src + morton * voxelSize, voxelSize );
+        }
+      }
+    }
+
+    return 0;
+  }
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)
+  for ( i=0; i<zdim; i++ )
+  {
+    int j, k;
+    uint64_t zc = zcode[i];
+    size_t row = (size_t)i * ydim * xdim;
+
+    switch ( voxelSize )
+    {
+      case 1: MORTON_RELAYOUT_LOOP ( uint8_t ); break;
+      case 2: MORTON_RELAYOUT_LOOP ( uint16_t ); break;
+      case 4: MORTON_RELAYOUT_LOOP ( uint32_t ); break;
+      case 8: MORTON_RELAYOUT_LOOP ( uint64_t ); break;
+      default:
+        for ( j=0; j<ydim; j++ )
+          for ( k=0; k<xdim; k++, row++ )
+          {
+            size_t morton = zc | ycode[j] | xcode[k];
+            if ( dir == 0 )
+              memcpy ( dst + morton * voxelSize, src + row * voxelSize, voxelSize );
+            else
+              memcpy ( dst + row * voxelSize, src + morton * voxelSize, voxelSize );
+          }
+    }
+  }
+
+  free ( zcode );
+  free ( ycode );
+  free ( xcode );
+  return 0;
+}
+
+// Relayout a row-major (z, y, x) cube into the compact Z-curve order.
+// Returns 0 on success, negative on failure.
+int toMortonLayout ( uint8_t * src, uint8_t * dst, int * dims, int voxelSize )
+{
+  return mortonRelayout ( src, dst, dims, voxelSize, 0 );
+}
+
+// Relayout a compact Z-curve cube back into row-major (z, y, x) order.
+// Returns 0 on success, negative on failure.
+int fromMortonLayout ( uint8_t * src, uint8_t * dst, int * dims, int voxelSize )
+{
+  return mortonRelayout ( src, dst, dims, voxelSize, 1 );
+}
+
+/*
+ * Downsample vote over a morton-layout annotation cube. Each source
+ * block of zFactor*2*2 voxels is contiguous (4 elements when zFactor
+ * is 1, 8 when it is 2) and is reduced with the addAnnotationData vote
+ * semantics: the low quad votes first and the high-z quad is used when
+ * it comes up empty. dst[i] holds the vote of source block i, in
+ * source block order.
+ */
+void downsampleMortonVote64 ( uint64_t * src, uint64_t * dst, int64_t nBlocks, int zFactor )
+{
+  int64_t i;
+  int blockSize = ( zFactor == 2 ) ? 8 : 4;
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) schedule(static)
+  for ( i=0; i<nBlocks; i++ )
+  {
+    uint64_t * b = src + i * blockSize;
+    uint64_t v = getAnnValue64 ( b[0], b[1], b[2], b[3] );
+
+    if ( v == 0 && blockSize == 8 )
+      v = getAnnValue64 ( b[4], b[5], b[6], b[7] );
+
+    dst[i] = v;
+  }
+}
@@ -27,39 +27,99 @@ void filterCutout ( uint32_t * , int , uint32_t *, int );
 void filterCutoutOMP32 ( uint32_t *, int , uint32_t *, int );
 void filterCutoutOMP64 ( uint64_t *, int , uint64_t *, int );
 
+// Declaring the SIMD set-membership (bitset / binary search) implementation for filterCutout
+void filterCutoutSIMD32 ( uint32_t *, int , uint32_t *, int );
+void filterCutoutSIMD64 ( uint64_t *, int , uint64_t *, int );
+
+// Declaring the range and bitmap predicate implementations for filterCutout
+void filterCutoutRange32 ( uint32_t *, int , uint32_t , uint32_t );
+void filterCutoutRange64 ( uint64_t *, int , uint64_t , uint64_t );
+void filterCutoutBitmap32 ( uint32_t *, int , uint8_t * , uint32_t );
+void filterCutoutBitmap64 ( uint64_t *, int , uint8_t * , uint64_t );
+
+// Declaring the 4D (time-series) filterCutout variants; one call covers
+// every time sample, parallel over t*z slabs
+void filterCutoutOMP4D32 ( uint32_t * , int , int64_t , int * , uint32_t * , int );
+void filterCutoutOMP4D64 ( uint64_t * , int , int64_t , int * , uint64_t * , int );
+
 // Decalring the OpenMP cache optimized implementation for filterCutout
 void filterCutoutOMPCache ( uint32_t *, int, uint32_t *, int );
+void filterCutoutOMPCache64 ( uint64_t *, int, uint64_t *, int );
 
 // Declaring the annotateCube implementation
 int annotateCube ( uint32_t * , int , int * , int , uint32_t * , uint32_t [][3] , int , char, uint32_t [][3] );
+int annotateCube8 ( uint8_t * , int , int * , uint8_t , uint32_t * , uint32_t [][3] , int , char, uint32_t [][3] );
+int annotateCube16 ( uint16_t * , int , int * , uint16_t , uint32_t * , uint32_t [][3] , int , char, uint32_t [][3] );
+int annotateCube64 ( uint64_t * , int , int * , uint64_t , uint32_t * , uint32_t [][3] , int , char, uint32_t [][3] );
 
 // Declaring the locateCube implementation
 void locateCube ( uint64_t [][4] , int , uint32_t [][3] , int , int * );
 
+// Declaring the fused locate + morton-keyed radix sort implementation
+void locateAndSortCube ( uint64_t [][4] , int , uint32_t [][3] , int , int * );
+
 // Declaring XYZMorton zindex function
 uint64_t XYZMorton ( uint64_t * );
 
 // Declaring MortonXYZ zindex function
 void MortonXYZ ( uint64_t , uint64_t [3] );
 
+// Declaring the batch Morton encode/decode zindex functions
+void XYZMortonBatch ( uint64_t [][3] , int , uint64_t * );
+void MortonXYZBatch ( uint64_t * , int , uint64_t [][3] );
+
 // Declaring recolorCube function
 void recolorCubeOMP32 ( uint32_t * , int , int , uint32_t * , uint32_t * );
 void recolorCubeOMP64 ( uint64_t * , int , int , uint64_t * , uint64_t * );
 
+// Plane codes and entry points for the direct-to-RGBA recolor and fused
+// tile render engine; tiles are packed RGBA8 regardless of voxel width
+#define NDLIB_TILE_XY 0
+#define NDLIB_TILE_XZ 1
+#define NDLIB_TILE_YZ 2
+void recolorSliceRGBA32 ( uint32_t * , int , uint32_t * , uint32_t * );
+void recolorSliceRGBA64 ( uint64_t * , int , uint32_t * , uint32_t * );
+void renderTile32 ( uint32_t * , int * , int , int , uint32_t * , uint32_t * );
+void renderTile64 ( uint64_t * , int * , int , int , uint32_t * , uint32_t * );
+
 // Declaring Quick Sort function
 void quicksort ( uint64_t [][4] , int ); 
 
 // Declaring the shaveCube function
 void shaveCube ( uint32_t * , int , int * , int , uint32_t * , uint32_t [][3] , int , uint32_t [][3] , int , uint32_t [][3] , int );
+void shaveCube8 ( uint8_t * , int , int * , uint8_t , uint32_t * , uint32_t [][3] , int , uint32_t [][3] , int , uint32_t [][3] , int );
+void shaveCube16 ( uint16_t * , int , int * , uint16_t , uint32_t * , uint32_t [][3] , int , uint32_t [][3] , int , uint32_t [][3] , int );
+void shaveCube64 ( uint64_t * , int , int * , uint64_t , uint32_t * , uint32_t [][3] , int , uint32_t [][3] , int , uint32_t [][3] , int );
+
+// Declaring the batched annotate / shave engines; groups of locations are
+// delimited by an nGroups+1 prefix-sum array and counts come back through
+// the trailing int arrays
+void annotateCubeBatch ( uint32_t * , int , int * , uint32_t * , uint32_t * , uint32_t [][3] , int * , int , char , uint32_t [][3] , int * );
+void annotateCubeBatch8 ( uint8_t * , int , int * , uint8_t * , uint32_t * , uint32_t [][3] , int * , int , char , uint32_t [][3] , int * );
+void annotateCubeBatch16 ( uint16_t * , int , int * , uint16_t * , uint32_t * , uint32_t [][3] , int * , int , char , uint32_t [][3] , int * );
+void annotateCubeBatch64 ( uint64_t * , int , int * , uint64_t * , uint32_t * , uint32_t [][3] , int * , int , char , uint32_t [][3] , int * );
+void shaveCubeBatch ( uint32_t * , int , int * , uint32_t * , uint32_t * , uint32_t [][3] , int * , int , uint32_t [][3] , int * , uint32_t [][3] , int * );
+void shaveCubeBatch8 ( uint8_t * , int , int * , uint8_t * , uint32_t * , uint32_t [][3] , int * , int , uint32_t [][3] , int * , uint32_t [][3] , int * );
+void shaveCubeBatch16 ( uint16_t * , int , int * , uint16_t * , uint32_t * , uint32_t [][3] , int * , int , uint32_t [][3] , int * , uint32_t [][3] , int * );
+void shaveCubeBatch64 ( uint64_t * , int , int * , uint64_t * , uint32_t * , uint32_t [][3] , int * , int , uint32_t [][3] , int * , uint32_t [][3] , int * );
 
 // Declaring the annotateEntityDense function
 void annotateEntityDense ( uint32_t * , int * , int );
+void annotateEntityDense8 ( uint8_t * , int * , uint8_t );
+void annotateEntityDense16 ( uint16_t * , int * , uint16_t );
+void annotateEntityDense64 ( uint64_t * , int * , uint64_t );
 
 // Declaring the shaveDense function
 void shaveDense ( uint32_t * , uint32_t * , int * );
+void shaveDense8 ( uint8_t * , uint8_t * , int * );
+void shaveDense16 ( uint16_t * , uint16_t * , int * );
+void shaveDense64 ( uint64_t * , uint64_t * , int * );
 
 // Declaring the exceptionDense function
 void exceptionDense ( uint32_t * , uint32_t * , int * );
+void exceptionDense8 ( uint8_t * , uint8_t * , int * );
+void exceptionDense16 ( uint16_t * , uint16_t * , int * );
+void exceptionDense64 ( uint64_t * , uint64_t * , int * );
 
 // Declaring the overwriteDense function
 void overwriteDense ( uint32_t * , uint32_t * , int * );  // Legacy overwrite function is for uint32 data
@@ -67,12 +127,41 @@ void overwriteDense8 ( uint8_t * , uint8_t * , int * );
 void overwriteDense16 ( uint16_t * , uint16_t * , int * );
 void overwriteDense64 ( uint64_t * , uint64_t * , int * );
 
+// Declaring the 4D (time-series) overwriteDense variants; one call covers
+// every time sample, parallel over t*z slabs
+void overwriteDense4D ( uint32_t * , uint32_t * , int , int64_t , int * );
+void overwriteDense4D8 ( uint8_t * , uint8_t * , int , int64_t , int * );
+void overwriteDense4D16 ( uint16_t * , uint16_t * , int , int64_t , int * );
+void overwriteDense4D64 ( uint64_t * , uint64_t * , int , int64_t , int * );
+
+// Op codes and entry points for the fused dense merge engine; ops apply in
+// order per voxel with the same semantics as the single-op kernels above
+#define NDLIB_DENSE_OVERWRITE 0
+#define NDLIB_DENSE_EXCEPTION 1
+#define NDLIB_DENSE_SHAVE 2
+void applyDenseOps ( uint32_t * , uint32_t ** , int * , int , int64_t );
+void applyDenseOps8 ( uint8_t * , uint8_t ** , int * , int , int64_t );
+void applyDenseOps16 ( uint16_t * , uint16_t ** , int * , int , int64_t );
+void applyDenseOps64 ( uint64_t * , uint64_t ** , int * , int , int64_t );
+
+// Declaring the overwriteDense variants that report a per-slice dirty bitmap
+int overwriteDenseDirty ( uint32_t * , uint32_t * , int * , uint8_t * );
+int overwriteDenseDirty8 ( uint8_t * , uint8_t * , int * , uint8_t * );
+int overwriteDenseDirty16 ( uint16_t * , uint16_t * , int * , uint8_t * );
+int overwriteDenseDirty64 ( uint64_t * , uint64_t * , int * , uint8_t * );
+
 // Declaring the zoomOutData function
 void zoomOutData ( uint32_t * , uint32_t * , int * , int );
 
 // Declaring the zoomOutData function OMP optimized
 void zoomOutDataOMP ( uint32_t * , uint32_t * , int * , int );
 
+// Declaring the fused multi-level downsample engine
+void buildResolutionPyramid8 ( uint8_t * , uint8_t ** , int , int * );
+void buildResolutionPyramid16 ( uint16_t * , uint16_t ** , int , int * );
+void buildResolutionPyramid32 ( uint32_t * , uint32_t ** , int , int * );
+void buildResolutionPyramid64 ( uint64_t * , uint64_t ** , int , int * );
+
 // Declaring the zoomInData function
 void zoomInData ( uint32_t * , uint32_t * , int * , int );
 
@@ -82,6 +171,16 @@ void zoomInDataOMP32 ( uint32_t * , uint32_t * , int * , int );
 
 // Declaring the mergeCube function
 void mergeCube ( uint32_t * , int * , int , int );
+void mergeCube8 ( uint8_t * , int * , uint8_t , uint8_t );
+void mergeCube16 ( uint16_t * , int * , uint16_t , uint16_t );
+void mergeCube64 ( uint64_t * , int * , uint64_t , uint64_t );
+
+// Declaring the table-driven batch relabel engine; applies a whole
+// (oldid, newid) table in one OpenMP pass
+void mergeCubeBatch ( uint32_t * , int64_t , uint32_t * , uint32_t * , int );
+void mergeCubeBatch8 ( uint8_t * , int64_t , uint8_t * , uint8_t * , int );
+void mergeCubeBatch16 ( uint16_t * , int64_t , uint16_t * , uint16_t * , int );
+void mergeCubeBatch64 ( uint64_t * , int64_t , uint64_t * , uint64_t * , int );
 
 // Declaring the isotropicBuild function
 void isotropicBuild32 ( uint32_t * , uint32_t * , uint32_t * , int * );
@@ -95,5 +194,144 @@ void addDataZslice ( uint32_t * , uint32_t *, int * , int * );
 // Declaring the addDataZSlice function
 void addDataIsotropic ( uint32_t * , uint32_t *, int * , int * );
 
+// Declaring the annotation vote helpers from addData.c
+uint32_t getAnnValue ( uint32_t , uint32_t , uint32_t , uint32_t );
+uint64_t getAnnValue64 ( uint64_t , uint64_t , uint64_t , uint64_t );
+
+// Declaring the OpenMP branchless addAnnotationData variant
+void addAnnotationDataOMP ( uint64_t * , uint64_t * , int * , int * );
+
+// Declaring the Morton-layout (Z-curve) relayout and downsample kernels
+int toMortonLayout ( uint8_t * , uint8_t * , int * , int );
+int fromMortonLayout ( uint8_t * , uint8_t * , int * , int );
+void downsampleMortonVote64 ( uint64_t * , uint64_t * , int64_t , int );
+
+// Declaring the OpenMP addData variants with a generalized power-of-two factor
+// and explicit output extents
+void addDataZSliceOMP ( uint32_t * , uint32_t * , int * , int * , int * , int );
+void addDataZSliceOMP64 ( uint64_t * , uint64_t * , int * , int * , int * , int );
+void addDataIsotropicOMP ( uint32_t * , uint32_t * , int * , int * , int * , int );
+void addDataIsotropicOMP64 ( uint64_t * , uint64_t * , int * , int * , int * , int );
+
+// Declaring the multi-cuboid scatter/gather cutout engines
+void copyCuboidRows ( uint8_t * , uint8_t * , uint64_t , int * , int * , uint64_t * , int , int , int );
+void assembleCutout ( uint8_t * , uint8_t ** , uint64_t * , int , int * , int * , uint64_t * , int , int );
+void sliceCutout ( uint8_t * , uint8_t ** , uint64_t * , int , int * , int * , uint64_t * , int , int );
+
+// Declaring the native blosc pipeline stage (blosc is dlopen'd at runtime)
+int bloscAvailable ( void );
+int64_t compressCuboid ( uint8_t * , uint64_t , int , uint8_t * , uint64_t );
+int64_t decompressCuboid ( uint8_t * , uint8_t * , uint64_t );
+int decompressCutout ( uint8_t * , uint8_t ** , uint64_t * , int , int * , int * , uint64_t * , int , int );
+
+// Declaring the large-cuboid (int64_t extents, size_t indexing) kernel
+// variants; legacy int-size entry points above are unchanged
+void overwriteDenseL ( uint32_t * , uint32_t * , int64_t * );
+void overwriteDense8L ( uint8_t * , uint8_t * , int64_t * );
+void overwriteDense16L ( uint16_t * , uint16_t * , int64_t * );
+void overwriteDense64L ( uint64_t * , uint64_t * , int64_t * );
+void filterCutoutOMP32L ( uint32_t * , int64_t , uint32_t * , int );
+void filterCutoutOMP64L ( uint64_t * , int64_t , uint64_t * , int );
+void zoomOutDataOMPL ( uint32_t * , uint32_t * , int64_t * , int );
+void zoomInDataOMPL ( uint32_t * , uint32_t * , int64_t * , int );
+void addDataZSliceOMPL ( uint32_t * , uint32_t * , int64_t * , int64_t * , int64_t * , int );
+void addDataZSliceOMPL64 ( uint64_t * , uint64_t * , int64_t * , int64_t * , int64_t * , int );
+void addDataIsotropicOMPL ( uint32_t * , uint32_t * , int64_t * , int64_t * , int64_t * , int );
+void addDataIsotropicOMPL64 ( uint64_t * , uint64_t * , int64_t * , int64_t * , int64_t * , int );
+int uniqueOMPL ( uint64_t * , uint64_t * , int64_t , int );
+
+// Declaring the run-length-encoded cuboid format; runs are width-independent
+// (value, length) pairs of uint64 in flat scan order
+int64_t rleEncode8 ( uint8_t * , int64_t , uint64_t * , int64_t );
+int64_t rleEncode16 ( uint16_t * , int64_t , uint64_t * , int64_t );
+int64_t rleEncode32 ( uint32_t * , int64_t , uint64_t * , int64_t );
+int64_t rleEncode64 ( uint64_t * , int64_t , uint64_t * , int64_t );
+void rleDecode8 ( uint64_t * , int64_t , uint8_t * );
+void rleDecode16 ( uint64_t * , int64_t , uint16_t * );
+void rleDecode32 ( uint64_t * , int64_t , uint32_t * );
+void rleDecode64 ( uint64_t * , int64_t , uint64_t * );
+int64_t rleFilter ( uint64_t * , int64_t , uint64_t * , int );
+int64_t rleUnique ( uint64_t * , int64_t , uint64_t * , int );
+int64_t rleOverwrite ( uint64_t * , int64_t , uint64_t * , int64_t , uint64_t * , int64_t );
+
+// Declaring the pipelined decompress-and-scatter stage
+void * cutoutPipelineCreate ( uint8_t * , int * , int * , uint64_t * , int , int , int );
+int cutoutPipelineSubmit ( void * , uint8_t * , uint64_t , uint64_t );
+int cutoutPipelineDrain ( void * );
+void cutoutPipelineDestroy ( void * );
+
 // Declaring the unique function
 int unique ( uint64_t *, uint64_t *, int );
+
+// Declaring the OpenMP radix sort unique function
+int uniqueOMP ( uint64_t *, uint64_t *, int );
+
+// Declaring the fused unique + per-id bounding box function
+int uniqueBBoxOMP ( uint64_t * , int * , int , uint64_t * , uint32_t [][6] );
+
+// Declaring the region-wide id union function
+int idsInRegionOMP ( uint64_t ** , int , int64_t , int , uint64_t * );
+
+// Declaring the per-time-sample id union function
+int unique4D ( uint64_t * , int , int64_t , int64_t , int , uint64_t * , int64_t * );
+
+// Declaring the parallel per-id voxel histogram function
+int idHistogramOMP ( uint64_t * , int64_t , int , uint64_t * , uint64_t * );
+
+// Declaring the library-level execution context functions
+void ndlibInit ( int , int );
+void ndlibSetThreads ( int );
+int ndlibGetThreads ( void );
+
+// Runtime CPU feature mask driving the multi-versioned kernel dispatch
+#define NDLIB_CPU_AVX2    0x1
+#define NDLIB_CPU_AVX512F 0x2
+#define NDLIB_CPU_BMI2    0x4
+
+int ndlibCpuFeatures ( void );
+void ndlibCpuSetFeatures ( int );
+
+// Declaring the scratch-buffer arena functions
+void * ndlibArenaCreate ( uint64_t );
+void * ndlibArenaAcquire ( void * , uint64_t );
+void ndlibArenaRelease ( void * );
+void ndlibArenaDestroy ( void * );
+
+// Hot-path instrumentation counter slots, one per kernel family
+typedef enum
+{
+  NDLIB_STAT_FILTER = 0,
+  NDLIB_STAT_MORTON,
+  NDLIB_STAT_SORT,
+  NDLIB_STAT_UNIQUE,
+  NDLIB_STAT_ASSEMBLE,
+  NDLIB_STAT_SLICE,
+  NDLIB_STAT_DECOMPRESS,
+  NDLIB_STAT_OVERWRITE,
+  NDLIB_STAT_SLOTS
+} NdlibStatSlot;
+
+// Declaring the instrumentation counter functions (always present; the
+// counters only advance when built with -DNDLIB_STATS)
+int ndlibStatsEnabled ( void );
+void ndlibStatsRecord ( int , uint64_t , uint64_t );
+void ndlibStatsSnapshot ( uint64_t [][3] );
+void ndlibStatsReset ( void );
+
+// Timing macros used inside the instrumented kernels; no-ops unless the
+// library is compiled with -DNDLIB_STATS
+#ifdef NDLIB_STATS
+#include<time.h>
+#define NDLIB_STAT_START( t0 ) struct timespec t0; clock_gettime ( CLOCK_MONOTONIC, &t0 )
+#define NDLIB_STAT_END( t0, slot, voxels )                                               \
+do {                                                                                     \
+  struct timespec _t1;                                                                   \
+  clock_gettime ( CLOCK_MONOTONIC, &_t1 );                                               \
+  ndlibStatsRecord ( slot, (uint64_t)(voxels),                                           \
+                     (uint64_t)(_t1.tv_sec - t0.tv_sec) * 1000000000ULL                  \
+                     + _t1.tv_nsec - t0.tv_nsec );                                       \
+} while (0)
+#else
+#define NDLIB_STAT_START( t0 )
+#define NDLIB_STAT_END( t0, slot, voxels )
+#endif
@@ -0,0 +1,95 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Scratch-buffer arena
+ *
+ * A long-lived bump allocator the Python wrappers draw their per-call
+ * scratch arrays from, so a SpatialDB instance can run cutout after
+ * cutout without steady-state allocation in the kernel layer. Acquire
+ * is a single atomic add (safe from concurrent callers), Release
+ * resets the whole arena; there is deliberately no per-buffer free.
+ * Buffers are 64-byte aligned so they start on cache-line boundaries.
+ */
+
+#include<stdint.h>
+#include<stdlib.h>
+
+#define ARENA_ALIGN 64
+
+typedef struct
+{
+  uint8_t * base;
+  uint64_t capacity;
+  uint64_t used;
+} NdlibArena;
+
+// Create an arena holding capacity bytes; returns NULL on failure
+void * ndlibArenaCreate ( uint64_t capacity )
+{
+  NdlibArena * arena = malloc ( sizeof(NdlibArena) );
+
+  if ( arena == NULL )
+    return NULL;
+
+  if ( posix_memalign ( (void**)&arena->base, ARENA_ALIGN, capacity ) != 0 )
+  {
+    free ( arena );
+    return NULL;
+  }
+
+  arena->capacity = capacity;
+  arena->used = 0;
+  return arena;
+}
+
+// Carve bytes out of the arena; returns NULL when the arena is exhausted
+// so the caller can fall back to a regular allocation
+void * ndlibArenaAcquire ( void * handle, uint64_t bytes )
+{
+  NdlibArena * arena = handle;
+  uint64_t aligned = ( bytes + ARENA_ALIGN - 1 ) & ~(uint64_t)( ARENA_ALIGN - 1 );
+  uint64_t offset = __atomic_fetch_add ( &arena->used, aligned, __ATOMIC_RELAXED );
+
+  if ( offset + aligned > arena->capacity )
+  {
+    // back the bump out so later smaller requests can still fit
+    __atomic_fetch_sub ( &arena->used, aligned, __ATOMIC_RELAXED );
+    return NULL;
+  }
+
+  return arena->base + offset;
+}
+
+// Reset the arena, invalidating every buffer acquired since the last release
+void ndlibArenaRelease ( void * handle )
+{
+  NdlibArena * arena = handle;
+  __atomic_store_n ( &arena->used, 0, __ATOMIC_RELAXED );
+}
+
+// Free the arena and its backing storage
+void ndlibArenaDestroy ( void * handle )
+{
+  NdlibArena * arena = handle;
+
+  if ( arena == NULL )
+    return;
+
+  free ( arena->base );
+  free ( arena );
+}
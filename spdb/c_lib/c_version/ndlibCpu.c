@@ -0,0 +1,70 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Runtime CPU feature dispatch
+ *
+ * ndlib.so is built without -march so one binary runs on every machine
+ * in a mixed fleet. The multi-versioned kernels instead carry baseline,
+ * AVX2 and AVX-512 bodies compiled with per-function target attributes
+ * and pick one at run time from the feature mask probed here. The probe
+ * runs once on first use and is cached, so the per-call dispatch cost
+ * is a load and a branch.
+ *
+ * ndlibCpuFeatures exposes the active mask to the Python layer so a
+ * deployment can verify which paths are live on a given host, and
+ * ndlibCpuSetFeatures lets callers mask features off (for debugging or
+ * A/B timing); it can only disable features the hardware has, never
+ * enable ones it lacks.
+ */
+
+#include<ndlib.h>
+
+// Feature mask actually in use; -1 until first probe
+static int cpuFeatures = -1;
+
+// Mask the hardware supports, probed once
+static int probeFeatures ( void )
+{
+  int mask = 0;
+
+#if defined(__x86_64__)
+  if ( __builtin_cpu_supports ( "avx2" ) )
+    mask |= NDLIB_CPU_AVX2;
+  if ( __builtin_cpu_supports ( "avx512f" ) )
+    mask |= NDLIB_CPU_AVX512F;
+  if ( __builtin_cpu_supports ( "bmi2" ) )
+    mask |= NDLIB_CPU_BMI2;
+#endif
+
+  return mask;
+}
+
+// Feature mask the kernels dispatch on
+int ndlibCpuFeatures ( void )
+{
+  if ( cpuFeatures < 0 )
+    cpuFeatures = probeFeatures ();
+  return cpuFeatures;
+}
+
+// Restrict dispatch to the given mask; features the hardware lacks
+// stay off regardless. Pass ~0 to restore full hardware dispatch.
+void ndlibCpuSetFeatures ( int mask )
+{
+  cpuFeatures = probeFeatures () & mask;
+}
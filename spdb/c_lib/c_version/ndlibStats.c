@@ -0,0 +1,77 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Hot-path instrumentation counters
+ *
+ * Each instrumented kernel family records calls, voxels processed and
+ * wall nanoseconds into one slot of a small atomic counter table via the
+ * NDLIB_STAT_START / NDLIB_STAT_END macros in ndlib.h. The macros
+ * compile to nothing unless ndlib is built with -DNDLIB_STATS (see
+ * makefile_LINUX), so the production build pays only for an untouched
+ * static table. ndlibStatsSnapshot and ndlibStatsReset always exist so
+ * the python binding works against either build.
+ */
+
+#include<stdint.h>
+#include<string.h>
+#include<ndlib.h>
+
+// One row per NdlibStatSlot: calls, voxels, nanoseconds
+static uint64_t statTable[NDLIB_STAT_SLOTS][3];
+
+// Report whether the kernels were compiled with the counters enabled
+int ndlibStatsEnabled ( void )
+{
+#ifdef NDLIB_STATS
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+// Accumulate one timed call into a slot. Relaxed atomics keep the cost
+// to a few uncontended fetch-adds per kernel invocation.
+void ndlibStatsRecord ( int slot, uint64_t voxels, uint64_t nanoseconds )
+{
+  if ( slot < 0 || slot >= NDLIB_STAT_SLOTS )
+    return;
+
+  __atomic_fetch_add ( &statTable[slot][0], 1, __ATOMIC_RELAXED );
+  __atomic_fetch_add ( &statTable[slot][1], voxels, __ATOMIC_RELAXED );
+  __atomic_fetch_add ( &statTable[slot][2], nanoseconds, __ATOMIC_RELAXED );
+}
+
+// Copy the counter table into a caller-provided NDLIB_STAT_SLOTS x 3 array
+void ndlibStatsSnapshot ( uint64_t counters[][3] )
+{
+  int i, j;
+
+  for ( i=0; i<NDLIB_STAT_SLOTS; i++ )
+    for ( j=0; j<3; j++ )
+      counters[i][j] = __atomic_load_n ( &statTable[i][j], __ATOMIC_RELAXED );
+}
+
+// Zero every counter
+void ndlibStatsReset ( void )
+{
+  int i, j;
+
+  for ( i=0; i<NDLIB_STAT_SLOTS; i++ )
+    for ( j=0; j<3; j++ )
+      __atomic_store_n ( &statTable[i][j], 0, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,78 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Library-level execution context
+ *
+ * Every kernel sizes its parallel region with omp_get_max_threads(),
+ * which defaults to the machine core count in every worker process, so
+ * a 12-worker deployment oversubscribes the box 12-fold. ndlibInit
+ * applies the thread settings once per process: it pins the OpenMP
+ * thread count (disabling dynamic adjustment so the runtime keeps the
+ * team alive and consistent between kernel calls), optionally pins each
+ * pool thread to a core, and warms the pool with one empty region so
+ * the first real kernel call does not pay thread spawn. Because the
+ * kernels all consult omp_get_max_threads(), the setting reaches every
+ * parallel region without touching them; ndlibSetThreads gives callers
+ * a per-call override through the same mechanism.
+ */
+
+#define _GNU_SOURCE
+#include<sched.h>
+#include<pthread.h>
+#include<unistd.h>
+#include<omp.h>
+
+// Apply the process-wide kernel thread settings. nthreads <= 0 keeps
+// the current thread count; affinity != 0 pins the pool threads to
+// cores round-robin.
+void ndlibInit ( int nthreads, int affinity )
+{
+  omp_set_dynamic ( 0 );
+
+  if ( nthreads > 0 )
+    omp_set_num_threads ( nthreads );
+
+  // warm the persistent pool (and pin it when asked) so later kernel
+  // calls reuse live threads instead of spawning
+  #pragma omp parallel num_threads(omp_get_max_threads())
+  {
+    if ( affinity )
+    {
+      long ncores = sysconf ( _SC_NPROCESSORS_ONLN );
+      cpu_set_t set;
+
+      CPU_ZERO ( &set );
+      CPU_SET ( omp_get_thread_num () % ( ncores > 0 ? ncores : 1 ), &set );
+      pthread_setaffinity_np ( pthread_self (), sizeof(set), &set );
+    }
+  }
+}
+
+// Per-call thread-count override; reaches every kernel through
+// omp_get_max_threads() just like ndlibInit
+void ndlibSetThreads ( int nthreads )
+{
+  if ( nthreads > 0 )
+    omp_set_num_threads ( nthreads );
+}
+
+// Current kernel thread count
+int ndlibGetThreads ( void )
+{
+  return omp_get_max_threads ();
+}
@@ -1,12 +1,12 @@
 /*
 * Copyright 2014 NeuroData (http://neurodata.io)
-* 
+*
 * Licensed under the Apache License, Version 2.0 (the "License");
 * you may not use this file except in compliance with the License.
 * You may obtain a copy of the License at
-* 
+*
 *     http://www.apache.org/licenses/LICENSE-2.0
-* 
+*
 * Unless required by applicable law or agreed to in writing, software
 * distributed under the License is distributed on an "AS IS" BASIS,
 * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -16,81 +16,157 @@
 
 
 /*
- * Shave Dense Entity Function 
- * Naive implementation 
+ * Overwrite Dense Entity Function
+ * Naive implementation, macro expanded for each supported voxel width
+ *
+ * The Dirty variants do the same single-pass merge but also record which
+ * outermost (z) slices actually changed in a caller-provided bitmap and
+ * return the total number of changed voxels, so the write path can skip
+ * re-serializing cuboids and time samples the merge left untouched.
  */
 
 #include<stdint.h>
+#include<omp.h>
 #include<ndlib.h>
 
-void overwriteDense( uint32_t * data, uint32_t * annodata ,int * dims )
-{
-	int i,j,k,index;
-
-    int xdim = dims[0];
-    int ydim = dims[1];
-    int zdim = dims[2];
-    
-	for ( i=0; i<xdim; i++ )
-      for ( j=0; j<ydim; j++ )
-        for ( k=0; k<zdim; k++ )
-        {
-          index = (i*zdim*ydim)+(j*zdim)+(k);
-          if ( annodata[index] !=0 )
-            data[index] = annodata[index];
-        }
+#define GEN_OVERWRITE_DENSE( NAME, TYPE )                         \
+void NAME ( TYPE * data, TYPE * annodata, int * dims )            \
+{                                                                 \
+    int i,j,k,index;                                              \
+                                                                  \
+    int xdim = dims[0];                                           \
+    int ydim = dims[1];                                           \
+    int zdim = dims[2];                                           \
+                                                                  \
+    for ( i=0; i<xdim; i++ )                                      \
+      for ( j=0; j<ydim; j++ )                                    \
+        for ( k=0; k<zdim; k++ )                                  \
+        {                                                         \
+          index = (i*zdim*ydim)+(j*zdim)+(k);                     \
+          if ( annodata[index] !=0 )                              \
+            data[index] = annodata[index];                        \
+        }                                                         \
 }
 
-void overwriteDense8( uint8_t * data, uint8_t * annodata ,int * dims )
-{
-	int i,j,k,index;
-
-    int xdim = dims[0];
-    int ydim = dims[1];
-    int zdim = dims[2];
-
-	for ( i=0; i<xdim; i++ )
-      for ( j=0; j<ydim; j++ )
-        for ( k=0; k<zdim; k++ )
-        {
-          index = (i*zdim*ydim)+(j*zdim)+(k);
-          if ( annodata[index] !=0 )
-            data[index] = annodata[index];
-        }
+GEN_OVERWRITE_DENSE ( overwriteDense, uint32_t )   // Legacy overwrite function is for uint32 data
+GEN_OVERWRITE_DENSE ( overwriteDense8, uint8_t )
+GEN_OVERWRITE_DENSE ( overwriteDense16, uint16_t )
+GEN_OVERWRITE_DENSE ( overwriteDense64, uint64_t )
+
+#define GEN_OVERWRITE_DENSE_DIRTY( NAME, TYPE )                        \
+int NAME ( TYPE * data, TYPE * annodata, int * dims, uint8_t * dirty ) \
+{                                                                      \
+    int i,j,k,index;                                                   \
+    int changed = 0;                                                   \
+    NDLIB_STAT_START ( statT0 );                                       \
+                                                                       \
+    int xdim = dims[0];                                                \
+    int ydim = dims[1];                                                \
+    int zdim = dims[2];                                                \
+                                                                       \
+    for ( i=0; i<xdim; i++ )                                           \
+    {                                                                  \
+      int slice_changed = 0;                                           \
+      for ( j=0; j<ydim; j++ )                                         \
+        for ( k=0; k<zdim; k++ )                                       \
+        {                                                              \
+          index = (i*zdim*ydim)+(j*zdim)+(k);                          \
+          if ( annodata[index] !=0 && data[index] != annodata[index] ) \
+          {                                                            \
+            data[index] = annodata[index];                             \
+            slice_changed += 1;                                        \
+          }                                                            \
+        }                                                              \
+      dirty[i] = slice_changed ? 1 : 0;                                \
+      changed += slice_changed;                                        \
+    }                                                                  \
+    NDLIB_STAT_END ( statT0, NDLIB_STAT_OVERWRITE,                     \
+                     (uint64_t)xdim * ydim * zdim );                   \
+    return changed;                                                    \
 }
 
-void overwriteDense16( uint16_t * data, uint16_t * annodata ,int * dims )
-{
-	int i,j,k,index;
-
-    int xdim = dims[0];
-    int ydim = dims[1];
-    int zdim = dims[2];
-
-	for ( i=0; i<xdim; i++ )
-      for ( j=0; j<ydim; j++ )
-        for ( k=0; k<zdim; k++ )
-        {
-          index = (i*zdim*ydim)+(j*zdim)+(k);
-          if ( annodata[index] !=0 )
-            data[index] = annodata[index];
-        }
+GEN_OVERWRITE_DENSE_DIRTY ( overwriteDenseDirty, uint32_t )
+GEN_OVERWRITE_DENSE_DIRTY ( overwriteDenseDirty8, uint8_t )
+GEN_OVERWRITE_DENSE_DIRTY ( overwriteDenseDirty16, uint16_t )
+GEN_OVERWRITE_DENSE_DIRTY ( overwriteDenseDirty64, uint64_t )
+
+/*
+ * Multi-versioned merge runs
+ *
+ * The contiguous keep-or-overwrite loop is compiled three times -
+ * baseline, AVX2 and AVX-512 - from one body via per-function target
+ * attributes, and the 4D kernel picks the widest body the host supports
+ * through ndlibCpuFeatures; the compiler turns the wide bodies into
+ * masked blends. The shared ndlib.so carries no -march flags.
+ */
+
+#define OVERWRITE_RUN_BODY( TYPE )                                \
+{                                                                 \
+  int64_t i;                                                      \
+  for ( i=0; i<n; i++ )                                           \
+    if ( annodata[i] != 0 )                                       \
+      data[i] = annodata[i];                                      \
 }
 
-void overwriteDense64( uint64_t * data, uint64_t * annodata ,int * dims )
-{
-	int i,j,k,index;
-
-    int xdim = dims[0];
-    int ydim = dims[1];
-    int zdim = dims[2];
-
-	for ( i=0; i<xdim; i++ )
-      for ( j=0; j<ydim; j++ )
-        for ( k=0; k<zdim; k++ )
-        {
-          index = (i*zdim*ydim)+(j*zdim)+(k);
-          if ( annodata[index] !=0 )
-            data[index] = annodata[index];
-        }
+#if defined(__x86_64__)
+
+#define GEN_OVERWRITE_RUN( NAME, TYPE )                                       \
+static void NAME##Base ( TYPE * data, const TYPE * annodata, int64_t n )      \
+OVERWRITE_RUN_BODY ( TYPE )                                                   \
+__attribute__((target("avx2")))                                               \
+static void NAME##AVX2 ( TYPE * data, const TYPE * annodata, int64_t n )      \
+OVERWRITE_RUN_BODY ( TYPE )                                                   \
+__attribute__((target("avx512f")))                                            \
+static void NAME##AVX512 ( TYPE * data, const TYPE * annodata, int64_t n )    \
+OVERWRITE_RUN_BODY ( TYPE )                                                   \
+static void NAME ( TYPE * data, const TYPE * annodata, int64_t n )            \
+{                                                                             \
+  int cpu = ndlibCpuFeatures ();                                              \
+  if ( cpu & NDLIB_CPU_AVX512F )                                              \
+    NAME##AVX512 ( data, annodata, n );                                       \
+  else if ( cpu & NDLIB_CPU_AVX2 )                                            \
+    NAME##AVX2 ( data, annodata, n );                                         \
+  else                                                                        \
+    NAME##Base ( data, annodata, n );                                         \
 }
+
+#else
+
+#define GEN_OVERWRITE_RUN( NAME, TYPE )                                       \
+static void NAME ( TYPE * data, const TYPE * annodata, int64_t n )            \
+OVERWRITE_RUN_BODY ( TYPE )
+
+#endif
+
+GEN_OVERWRITE_RUN ( overwriteRun, uint32_t )
+GEN_OVERWRITE_RUN ( overwriteRun8, uint8_t )
+GEN_OVERWRITE_RUN ( overwriteRun16, uint16_t )
+GEN_OVERWRITE_RUN ( overwriteRun64, uint64_t )
+
+// 4D variant: merges every time sample of a (t, z, y, x) cuboid in one
+// call instead of one ctypes crossing and OMP region per sample. The
+// work is split over t*z slabs so short time series still fill the
+// thread pool. tstride is the voxel stride between samples (the sample
+// size when contiguous) and dims are the per-sample [z, y, x] extents.
+#define GEN_OVERWRITE_DENSE_4D( NAME, TYPE, RUNFN )                       \
+void NAME ( TYPE * data, TYPE * annodata, int timeSamples,                \
+            int64_t tstride, int * dims )                                 \
+{                                                                         \
+    int64_t s;                                                            \
+    int zdim = dims[0];                                                   \
+    int64_t slabSize = (int64_t)dims[1] * dims[2];                        \
+    int64_t nSlabs = (int64_t)timeSamples * zdim;                         \
+                                                                          \
+    _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(static)" ) \
+    for ( s=0; s<nSlabs; s++ )                                            \
+    {                                                                     \
+      int64_t base = ( s / zdim ) * tstride + ( s % zdim ) * slabSize;    \
+                                                                          \
+      RUNFN ( data+base, annodata+base, slabSize );                       \
+    }                                                                     \
+}
+
+GEN_OVERWRITE_DENSE_4D ( overwriteDense4D, uint32_t, overwriteRun )
+GEN_OVERWRITE_DENSE_4D ( overwriteDense4D8, uint8_t, overwriteRun8 )
+GEN_OVERWRITE_DENSE_4D ( overwriteDense4D16, uint16_t, overwriteRun16 )
+GEN_OVERWRITE_DENSE_4D ( overwriteDense4D64, uint64_t, overwriteRun64 )
@@ -0,0 +1,208 @@
+/*
+* Copyright 2016 The Johns Hopkins University Applied Physics Laboratory
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+/*
+ * Run-length-encoded sparse cuboid format
+ *
+ * Annotation cuboids are mostly zeros or long constant runs, so the
+ * dense kernels touch every voxel to move very little information.
+ * A cuboid is encoded as (value, length) pairs of uint64 in flat scan
+ * order, one width-specific encoder/decoder per voxel size; the run
+ * stream itself is width-independent so the run-level operators below
+ * work on any encoded cuboid. Encoders return -1 when the stream would
+ * exceed the caller's run budget (an incompressible cuboid), which is
+ * the signal to stay dense.
+ *
+ * The run-level overwrite/filter/unique operators cost O(runs), not
+ * O(voxels), which is what makes sparse writes and id scans cheap.
+ */
+
+#include<stdint.h>
+#include<stdlib.h>
+
+#define GEN_RLE_ENCODE( NAME, TYPE )                                     \
+int64_t NAME ( TYPE * src, int64_t n, uint64_t * runs, int64_t maxRuns ) \
+{                                                                        \
+    int64_t i = 0, r = 0;                                                \
+                                                                         \
+    while ( i < n )                                                      \
+    {                                                                    \
+      TYPE v = src[i];                                                   \
+      int64_t start = i;                                                 \
+                                                                         \
+      while ( i < n && src[i] == v )                                     \
+        i += 1;                                                          \
+                                                                         \
+      if ( r == maxRuns )                                                \
+        return -1;                                                       \
+                                                                         \
+      runs[2*r] = v;                                                     \
+      runs[2*r+1] = i - start;                                           \
+      r += 1;                                                            \
+    }                                                                    \
+                                                                         \
+    return r;                                                            \
+}
+
+GEN_RLE_ENCODE ( rleEncode8, uint8_t )
+GEN_RLE_ENCODE ( rleEncode16, uint16_t )
+GEN_RLE_ENCODE ( rleEncode32, uint32_t )
+GEN_RLE_ENCODE ( rleEncode64, uint64_t )
+
+#define GEN_RLE_DECODE( NAME, TYPE )                                     \
+void NAME ( uint64_t * runs, int64_t nRuns, TYPE * dst )                 \
+{                                                                        \
+    int64_t r, k;                                                        \
+                                                                         \
+    for ( r=0; r<nRuns; r++ )                                            \
+    {                                                                    \
+      TYPE v = ( TYPE ) runs[2*r];                                       \
+      int64_t len = ( int64_t ) runs[2*r+1];                             \
+                                                                         \
+      for ( k=0; k<len; k++ )                                            \
+        *dst++ = v;                                                      \
+    }                                                                    \
+}
+
+GEN_RLE_DECODE ( rleDecode8, uint8_t )
+GEN_RLE_DECODE ( rleDecode16, uint16_t )
+GEN_RLE_DECODE ( rleDecode32, uint32_t )
+GEN_RLE_DECODE ( rleDecode64, uint64_t )
+
+// Coalesce adjacent runs with equal values in place; returns the new run count
+static int64_t rleCoalesce ( uint64_t * runs, int64_t nRuns )
+{
+  int64_t r, out = 0;
+
+  for ( r=0; r<nRuns; r++ )
+  {
+    if ( out > 0 && runs[2*(out-1)] == runs[2*r] )
+      runs[2*(out-1)+1] += runs[2*r+1];
+    else
+    {
+      runs[2*out] = runs[2*r];
+      runs[2*out+1] = runs[2*r+1];
+      out += 1;
+    }
+  }
+
+  return out;
+}
+
+// Zero every run whose value is not in the filter list, in place.
+// O(runs * log list) instead of O(voxels * list); returns the new run
+// count after coalescing the zeroed neighbors.
+int64_t rleFilter ( uint64_t * runs, int64_t nRuns, uint64_t * filterlist, int listsize )
+{
+  int64_t r;
+
+  for ( r=0; r<nRuns; r++ )
+  {
+    uint64_t v = runs[2*r];
+    int lo = 0, hi = listsize - 1, found = 0;
+
+    while ( lo <= hi )
+    {
+      int mid = lo + ( hi - lo ) / 2;
+      if ( filterlist[mid] == v ) { found = 1; break; }
+      else if ( filterlist[mid] < v ) lo = mid + 1;
+      else hi = mid - 1;
+    }
+
+    if ( !found )
+      runs[2*r] = 0;
+  }
+
+  return rleCoalesce ( runs, nRuns );
+}
+
+static int rleCmp64 ( const void * a, const void * b )
+{
+  uint64_t lhs = *( const uint64_t * ) a;
+  uint64_t rhs = *( const uint64_t * ) b;
+  return ( lhs > rhs ) - ( lhs < rhs );
+}
+
+// Collect the distinct nonzero run values in ascending order; returns
+// the id count, or -1 on allocation failure or when maxIds is exceeded
+int64_t rleUnique ( uint64_t * runs, int64_t nRuns, uint64_t * ids, int maxIds )
+{
+  uint64_t * values = malloc ( nRuns * sizeof(uint64_t) );
+  int64_t r, n = 0, out = 0;
+
+  if ( values == NULL )
+    return -1;
+
+  for ( r=0; r<nRuns; r++ )
+    if ( runs[2*r] != 0 )
+      values[n++] = runs[2*r];
+
+  qsort ( values, n, sizeof(uint64_t), rleCmp64 );
+
+  for ( r=0; r<n; r++ )
+  {
+    if ( out > 0 && ids[out-1] == values[r] )
+      continue;
+    if ( out == maxIds )
+    {
+      free ( values );
+      return -1;
+    }
+    ids[out++] = values[r];
+  }
+
+  free ( values );
+  return out;
+}
+
+// Overwrite dstRuns with the nonzero voxels of srcRuns (the run-level
+// form of overwriteDense; both streams must cover the same voxel
+// count). Two-pointer merge into out, coalescing as it goes; returns
+// the out run count or -1 when maxRuns would be exceeded.
+int64_t rleOverwrite ( uint64_t * dstRuns, int64_t nDst, uint64_t * srcRuns, int64_t nSrc,
+                       uint64_t * out, int64_t maxRuns )
+{
+  int64_t d = 0, s = 0, o = 0;
+  uint64_t dLeft = nDst > 0 ? dstRuns[1] : 0;
+  uint64_t sLeft = nSrc > 0 ? srcRuns[1] : 0;
+
+  while ( d < nDst && s < nSrc )
+  {
+    uint64_t take = dLeft < sLeft ? dLeft : sLeft;
+    uint64_t v = srcRuns[2*s] != 0 ? srcRuns[2*s] : dstRuns[2*d];
+
+    if ( o > 0 && out[2*(o-1)] == v )
+      out[2*(o-1)+1] += take;
+    else
+    {
+      if ( o == maxRuns )
+        return -1;
+      out[2*o] = v;
+      out[2*o+1] = take;
+      o += 1;
+    }
+
+    dLeft -= take;
+    sLeft -= take;
+    if ( dLeft == 0 && ++d < nDst )
+      dLeft = dstRuns[2*d+1];
+    if ( sLeft == 0 && ++s < nSrc )
+      sLeft = srcRuns[2*s+1];
+  }
+
+  return o;
+}
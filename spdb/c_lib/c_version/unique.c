@@ -16,12 +16,14 @@
 
 
 /*
- * Unique Function 
- * Naive implementation 
+ * Unique Function
+ * Naive implementation plus an OpenMP LSD radix sort variant
  */
 
 #include<stdint.h>
 #include<stdlib.h>
+#include<string.h>
+#include<omp.h>
 #include<ndlib.h>
 
 int cmpFunc32 ( const void * pa, const void * pb )
@@ -31,7 +33,11 @@ int cmpFunc32 ( const void * pa, const void * pb )
 
 int cmpFunc64 ( const void * pa, const void * pb )
 {
-  return ( *(const uint64_t*)pa - *(const uint64_t*)pb );
+  uint64_t a = *(const uint64_t*)pa;
+  uint64_t b = *(const uint64_t*)pb;
+
+  // the difference truncates for keys more than 31 bits apart
+  return ( a > b ) - ( a < b );
 }
 
 // Naive Implementation of Quicksort
@@ -47,6 +53,120 @@ void quicksort64 ( uint64_t * data, int dataSize )
 }
 
 
+/*
+ * OpenMP radix sort unique for uint64 keys
+ *
+ * Sorts with 8 LSD passes of 8 bits. Each pass counts into thread-local
+ * histograms, prefix sums them so every thread owns a stable slice of
+ * each bucket, then scatters in parallel. Passes where every key shares
+ * the same byte (the common case for the high bytes of annotation ids)
+ * are skipped. unique_array doubles as the ping-pong buffer, so the
+ * caller sees the same contract as unique().
+ */
+
+int uniqueOMP ( uint64_t * data, uint64_t * unique_array, int dataSize )
+{
+  int pass, t, b, i, index=0;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( dataSize <= 0 )
+    return 0;
+
+  int nthreads = omp_get_max_threads();
+  if ( nthreads > dataSize )
+    nthreads = 1;
+
+  uint64_t * src = data;
+  uint64_t * dst = unique_array;
+
+  /* histogram[t][b] = count of byte value b in thread t's chunk */
+  size_t * histogram = malloc ( (size_t)nthreads * 256 * sizeof(size_t) );
+  if ( histogram == NULL )
+    return unique ( data, unique_array, dataSize );
+
+  int chunk = ( dataSize + nthreads - 1 ) / nthreads;
+
+  for ( pass=0; pass<8; pass++ )
+  {
+    int shift = pass * 8;
+
+    memset ( histogram, 0, (size_t)nthreads * 256 * sizeof(size_t) );
+
+#pragma omp parallel num_threads(nthreads) private(i)
+    {
+      int tid = omp_get_thread_num();
+      size_t * local = histogram + (size_t)tid * 256;
+      int begin = tid * chunk;
+      int end = begin + chunk;
+      if ( end > dataSize )
+        end = dataSize;
+
+      for ( i=begin; i<end; i++ )
+        local[ (src[i] >> shift) & 0xFF ] += 1;
+    }
+
+    /* skip the pass when every key lands in one bucket */
+    int trivial = 0;
+    for ( b=0; b<256; b++ )
+    {
+      size_t total = 0;
+      for ( t=0; t<nthreads; t++ )
+        total += histogram[ (size_t)t * 256 + b ];
+      if ( total == (size_t)dataSize )
+      {
+        trivial = 1;
+        break;
+      }
+      if ( total > 0 )
+        break;
+    }
+    if ( trivial )
+      continue;
+
+    /* prefix sum bucket-major so each thread owns a stable slice */
+    size_t offset = 0;
+    for ( b=0; b<256; b++ )
+      for ( t=0; t<nthreads; t++ )
+      {
+        size_t count = histogram[ (size_t)t * 256 + b ];
+        histogram[ (size_t)t * 256 + b ] = offset;
+        offset += count;
+      }
+
+#pragma omp parallel num_threads(nthreads) private(i)
+    {
+      int tid = omp_get_thread_num();
+      size_t * local = histogram + (size_t)tid * 256;
+      int begin = tid * chunk;
+      int end = begin + chunk;
+      if ( end > dataSize )
+        end = dataSize;
+
+      for ( i=begin; i<end; i++ )
+        dst[ local[ (src[i] >> shift) & 0xFF ]++ ] = src[i];
+    }
+
+    uint64_t * tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  free ( histogram );
+
+  /* compact the sorted keys into unique_array */
+  for ( i=0; i<dataSize; i++ )
+  {
+    while ( i<dataSize-1 && src[i] == src[i+1] )
+      i++;
+
+    unique_array[index] = src[i];
+    index++;
+  }
+
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_UNIQUE, dataSize );
+  return index;
+}
+
 int unique( uint64_t * data, uint64_t * unique_array, int dataSize )
 {
   int i,index=0;
@@ -64,3 +184,780 @@ int unique( uint64_t * data, uint64_t * unique_array, int dataSize )
 
   return index;
 }
+
+/*
+ * Fused unique + per-id bounding box kernel
+ *
+ * One OpenMP pass over a (z, y, x) C-ordered uint64 cuboid produces the
+ * sorted set of non-zero ids together with each id's min/max x/y/z
+ * extent. Every thread accumulates into a private open-addressing hash
+ * table keyed by id; the tables are then merged with a sort over the
+ * combined entries. Saves the six axis-probe cutouts the tight bounding
+ * box path otherwise needs per id.
+ *
+ * Returns the number of unique non-zero ids, or -1 when a table could
+ * not be allocated or more than maxIds distinct ids were seen, in which
+ * case the caller falls back to the plain unique path.
+ */
+
+typedef struct
+{
+  uint64_t id;
+  uint32_t xmin, xmax, ymin, ymax, zmin, zmax;
+} BBoxEntry;
+
+static int cmpBBoxEntry ( const void * pa, const void * pb )
+{
+  uint64_t a = ((const BBoxEntry*)pa)->id;
+  uint64_t b = ((const BBoxEntry*)pb)->id;
+  return ( a > b ) - ( a < b );
+}
+
+// Insert or extend one voxel in a thread-local table. Returns 0 when the
+// table is full and could not be grown.
+static int bboxInsert ( BBoxEntry ** table, int * logcap, int * count,
+                        uint64_t id, uint32_t x, uint32_t y, uint32_t z )
+{
+  BBoxEntry * t = *table;
+  uint64_t mask = ( 1ULL << *logcap ) - 1;
+  uint64_t slot = ( id * 0x9E3779B97F4A7C15ULL ) >> ( 64 - *logcap );
+
+  while ( t[slot].id != 0 && t[slot].id != id )
+    slot = ( slot + 1 ) & mask;
+
+  if ( t[slot].id == id )
+  {
+    if ( x < t[slot].xmin ) t[slot].xmin = x;
+    if ( x > t[slot].xmax ) t[slot].xmax = x;
+    if ( y < t[slot].ymin ) t[slot].ymin = y;
+    if ( y > t[slot].ymax ) t[slot].ymax = y;
+    if ( z < t[slot].zmin ) t[slot].zmin = z;
+    if ( z > t[slot].zmax ) t[slot].zmax = z;
+    return 1;
+  }
+
+  t[slot].id = id;
+  t[slot].xmin = t[slot].xmax = x;
+  t[slot].ymin = t[slot].ymax = y;
+  t[slot].zmin = t[slot].zmax = z;
+  *count += 1;
+
+  /* grow at 70% load so probe chains stay short */
+  if ( (uint64_t)*count * 10 > ( mask + 1 ) * 7 )
+  {
+    int newlog = *logcap + 1;
+    BBoxEntry * grown = calloc ( 1ULL << newlog, sizeof(BBoxEntry) );
+    uint64_t i;
+
+    if ( grown == NULL )
+      return 0;
+
+    for ( i=0; i<=mask; i++ )
+      if ( t[i].id != 0 )
+      {
+        uint64_t s = ( t[i].id * 0x9E3779B97F4A7C15ULL ) >> ( 64 - newlog );
+        uint64_t newmask = ( 1ULL << newlog ) - 1;
+        while ( grown[s].id != 0 )
+          s = ( s + 1 ) & newmask;
+        grown[s] = t[i];
+      }
+
+    free ( t );
+    *table = grown;
+    *logcap = newlog;
+  }
+
+  return 1;
+}
+
+int uniqueBBoxOMP ( uint64_t * data, int * dims, int maxIds,
+                    uint64_t * unique_array, uint32_t boxes[][6] )
+{
+  int xdim = dims[0];
+  int ydim = dims[1];
+  int zdim = dims[2];
+
+  int nthreads = omp_get_max_threads();
+  if ( nthreads > zdim )
+    nthreads = zdim;
+  if ( nthreads < 1 )
+    nthreads = 1;
+
+  BBoxEntry ** tables = calloc ( nthreads, sizeof(BBoxEntry*) );
+  int * logcaps = malloc ( nthreads * sizeof(int) );
+  int * counts = calloc ( nthreads, sizeof(int) );
+  int fail = 0, total = 0, t, index;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( tables == NULL || logcaps == NULL || counts == NULL )
+  {
+    free ( tables );
+    free ( logcaps );
+    free ( counts );
+    return -1;
+  }
+
+#pragma omp parallel num_threads(nthreads) reduction(|:fail)
+  {
+    int tid = omp_get_thread_num();
+    int z, y, x, ok = 1;
+
+    logcaps[tid] = 10;
+    tables[tid] = calloc ( 1ULL << logcaps[tid], sizeof(BBoxEntry) );
+    if ( tables[tid] == NULL )
+      fail = 1;
+    else
+    {
+#pragma omp for schedule(static)
+      for ( z=0; z<zdim; z++ )
+      {
+        uint64_t * slice = data + (size_t)z * ydim * xdim;
+        /* a failed grow leaves the table near full, so stop inserting */
+        for ( y=0; ok && y<ydim; y++ )
+          for ( x=0; x<xdim; x++ )
+          {
+            uint64_t id = slice[ (size_t)y * xdim + x ];
+            if ( id != 0 )
+              if ( !bboxInsert ( &tables[tid], &logcaps[tid], &counts[tid], id, x, y, z ) )
+              {
+                fail = 1;
+                ok = 0;
+                break;
+              }
+          }
+      }
+    }
+  }
+
+  for ( t=0; t<nthreads; t++ )
+    total += counts[t];
+
+  if ( fail || total > maxIds )
+  {
+    for ( t=0; t<nthreads; t++ )
+      free ( tables[t] );
+    free ( tables );
+    free ( logcaps );
+    free ( counts );
+    return -1;
+  }
+
+  /* merge: collect every entry, sort by id, fold duplicates */
+  BBoxEntry * merged = malloc ( (size_t)( total > 0 ? total : 1 ) * sizeof(BBoxEntry) );
+  if ( merged == NULL )
+  {
+    for ( t=0; t<nthreads; t++ )
+      free ( tables[t] );
+    free ( tables );
+    free ( logcaps );
+    free ( counts );
+    return -1;
+  }
+
+  index = 0;
+  for ( t=0; t<nthreads; t++ )
+  {
+    uint64_t cap = 1ULL << logcaps[t], i;
+    for ( i=0; i<cap; i++ )
+      if ( tables[t][i].id != 0 )
+        merged[index++] = tables[t][i];
+    free ( tables[t] );
+  }
+  free ( tables );
+  free ( logcaps );
+  free ( counts );
+
+  qsort ( merged, index, sizeof(BBoxEntry), cmpBBoxEntry );
+
+  int out = 0;
+  int i;
+  for ( i=0; i<index; i++ )
+  {
+    if ( out > 0 && unique_array[out-1] == merged[i].id )
+    {
+      if ( merged[i].xmin < boxes[out-1][0] ) boxes[out-1][0] = merged[i].xmin;
+      if ( merged[i].xmax > boxes[out-1][1] ) boxes[out-1][1] = merged[i].xmax;
+      if ( merged[i].ymin < boxes[out-1][2] ) boxes[out-1][2] = merged[i].ymin;
+      if ( merged[i].ymax > boxes[out-1][3] ) boxes[out-1][3] = merged[i].ymax;
+      if ( merged[i].zmin < boxes[out-1][4] ) boxes[out-1][4] = merged[i].zmin;
+      if ( merged[i].zmax > boxes[out-1][5] ) boxes[out-1][5] = merged[i].zmax;
+    }
+    else
+    {
+      unique_array[out] = merged[i].id;
+      boxes[out][0] = merged[i].xmin;
+      boxes[out][1] = merged[i].xmax;
+      boxes[out][2] = merged[i].ymin;
+      boxes[out][3] = merged[i].ymax;
+      boxes[out][4] = merged[i].zmin;
+      boxes[out][5] = merged[i].zmax;
+      out += 1;
+    }
+  }
+
+  free ( merged );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_UNIQUE, (uint64_t)xdim * ydim * zdim );
+  return out;
+}
+
+/*
+ * Region-wide id union kernel
+ *
+ * Computes the union of the non-zero ids across a list of cuboid buffers
+ * (pass a single entry to reduce an assembled region) with thread-local
+ * hash sets over fixed-size voxel chunks, then merges the sets with a
+ * sort + fold into one sorted uint64 array. Replaces cutting the region
+ * out and unioning ids at the python level.
+ *
+ * Returns the number of unique non-zero ids, or -1 when a table could
+ * not be allocated or more than maxIds distinct ids were seen, in which
+ * case the caller falls back to the per-cuboid unique path.
+ */
+
+// Voxels handled per parallel work item; big enough to amortize the
+// cuboid-boundary bookkeeping, small enough to balance ragged regions
+#define IDS_CHUNK_VOXELS 65536
+
+// Insert one id into a thread-local set. Returns 0 when the set is full
+// and could not be grown.
+static int idInsert ( uint64_t ** table, int * logcap, int * count, uint64_t id )
+{
+  uint64_t * t = *table;
+  uint64_t mask = ( 1ULL << *logcap ) - 1;
+  uint64_t slot = ( id * 0x9E3779B97F4A7C15ULL ) >> ( 64 - *logcap );
+
+  while ( t[slot] != 0 && t[slot] != id )
+    slot = ( slot + 1 ) & mask;
+
+  if ( t[slot] == id )
+    return 1;
+
+  t[slot] = id;
+  *count += 1;
+
+  /* grow at 70% load so probe chains stay short */
+  if ( (uint64_t)*count * 10 > ( mask + 1 ) * 7 )
+  {
+    int newlog = *logcap + 1;
+    uint64_t * grown = calloc ( 1ULL << newlog, sizeof(uint64_t) );
+    uint64_t i;
+
+    if ( grown == NULL )
+      return 0;
+
+    for ( i=0; i<=mask; i++ )
+      if ( t[i] != 0 )
+      {
+        uint64_t s = ( t[i] * 0x9E3779B97F4A7C15ULL ) >> ( 64 - newlog );
+        uint64_t newmask = ( 1ULL << newlog ) - 1;
+        while ( grown[s] != 0 )
+          s = ( s + 1 ) & newmask;
+        grown[s] = t[i];
+      }
+
+    free ( t );
+    *table = grown;
+    *logcap = newlog;
+  }
+
+  return 1;
+}
+
+int idsInRegionOMP ( uint64_t ** cuboids, int nCuboids, int64_t cuboidVoxels,
+                     int maxIds, uint64_t * ids )
+{
+  int64_t totalVoxels = (int64_t)nCuboids * cuboidVoxels;
+  int64_t nChunks = ( totalVoxels + IDS_CHUNK_VOXELS - 1 ) / IDS_CHUNK_VOXELS;
+
+  int nthreads = omp_get_max_threads();
+  if ( (int64_t)nthreads > nChunks )
+    nthreads = (int)nChunks;
+  if ( nthreads < 1 )
+    nthreads = 1;
+
+  uint64_t ** tables = calloc ( nthreads, sizeof(uint64_t*) );
+  int * logcaps = malloc ( nthreads * sizeof(int) );
+  int * counts = calloc ( nthreads, sizeof(int) );
+  int fail = 0, total = 0, t, index;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( tables == NULL || logcaps == NULL || counts == NULL )
+  {
+    free ( tables );
+    free ( logcaps );
+    free ( counts );
+    return -1;
+  }
+
+#pragma omp parallel num_threads(nthreads) reduction(|:fail)
+  {
+    int tid = omp_get_thread_num();
+    int64_t chunk;
+    int ok = 1;
+
+    logcaps[tid] = 10;
+    tables[tid] = calloc ( 1ULL << logcaps[tid], sizeof(uint64_t) );
+    if ( tables[tid] == NULL )
+      fail = 1;
+    else
+    {
+#pragma omp for schedule(static)
+      for ( chunk=0; chunk<nChunks; chunk++ )
+      {
+        int64_t pos = chunk * IDS_CHUNK_VOXELS;
+        int64_t end = pos + IDS_CHUNK_VOXELS;
+        if ( end > totalVoxels )
+          end = totalVoxels;
+
+        /* a failed grow leaves the set near full, so stop inserting */
+        while ( ok && pos < end )
+        {
+          int c = (int)( pos / cuboidVoxels );
+          int64_t off = pos - (int64_t)c * cuboidVoxels;
+          int64_t run = end - pos;
+          if ( run > cuboidVoxels - off )
+            run = cuboidVoxels - off;
+
+          uint64_t * p = cuboids[c] + off;
+          uint64_t last = 0;
+          int64_t j;
+          for ( j=0; j<run; j++ )
+          {
+            /* skip zeros and immediate repeats; label data runs long */
+            if ( p[j] != 0 && p[j] != last )
+            {
+              last = p[j];
+              if ( !idInsert ( &tables[tid], &logcaps[tid], &counts[tid], p[j] ) )
+              {
+                fail = 1;
+                ok = 0;
+                break;
+              }
+            }
+          }
+          pos += run;
+        }
+      }
+    }
+  }
+
+  for ( t=0; t<nthreads; t++ )
+    total += counts[t];
+
+  if ( fail || total > maxIds )
+  {
+    for ( t=0; t<nthreads; t++ )
+      free ( tables[t] );
+    free ( tables );
+    free ( logcaps );
+    free ( counts );
+    return -1;
+  }
+
+  /* merge: collect every entry, sort, fold duplicates */
+  uint64_t * merged = malloc ( (size_t)( total > 0 ? total : 1 ) * sizeof(uint64_t) );
+  if ( merged == NULL )
+  {
+    for ( t=0; t<nthreads; t++ )
+      free ( tables[t] );
+    free ( tables );
+    free ( logcaps );
+    free ( counts );
+    return -1;
+  }
+
+  index = 0;
+  for ( t=0; t<nthreads; t++ )
+  {
+    uint64_t cap = 1ULL << logcaps[t], i;
+    for ( i=0; i<cap; i++ )
+      if ( tables[t][i] != 0 )
+        merged[index++] = tables[t][i];
+    free ( tables[t] );
+  }
+  free ( tables );
+  free ( logcaps );
+  free ( counts );
+
+  qsort ( merged, index, sizeof(uint64_t), cmpFunc64 );
+
+  int out = 0;
+  int i;
+  for ( i=0; i<index; i++ )
+    if ( out == 0 || ids[out-1] != merged[i] )
+      ids[out++] = merged[i];
+
+  free ( merged );
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_UNIQUE, (uint64_t)totalVoxels );
+  return out;
+}
+
+/*
+ * Per-time-sample id union kernel
+ *
+ * Computes the distinct non-zero ids of every time sample of a
+ * (t, z, y, x) cuboid in one call instead of one ctypes crossing and
+ * sort per sample. Samples are distributed across the thread pool and
+ * each builds its own hash set, so the per-sample extraction needs no
+ * synchronization; the sets are sorted and packed back to back into
+ * ids with offsets[t] .. offsets[t+1] delimiting sample t (offsets has
+ * timeSamples+1 entries). tstride is the voxel stride between samples
+ * (sampleSize when contiguous).
+ *
+ * Returns the total number of ids packed, or -1 when a table could not
+ * be allocated or more than maxIds ids were seen in total, in which
+ * case the caller falls back to the per-sample unique path.
+ */
+
+int unique4D ( uint64_t * data, int timeSamples, int64_t tstride, int64_t sampleSize,
+               int maxIds, uint64_t * ids, int64_t * offsets )
+{
+  uint64_t ** sampleIds = calloc ( timeSamples, sizeof(uint64_t*) );
+  int * counts = calloc ( timeSamples, sizeof(int) );
+  int fail = 0, total = 0, t;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( sampleIds == NULL || counts == NULL )
+  {
+    free ( sampleIds );
+    free ( counts );
+    return -1;
+  }
+
+#pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic) reduction(|:fail)
+  for ( t=0; t<timeSamples; t++ )
+  {
+    uint64_t * p = data + (size_t)t * tstride;
+    uint64_t last = 0;
+    int logcap = 10, count = 0, ok = 1;
+    uint64_t * table = calloc ( 1ULL << logcap, sizeof(uint64_t) );
+    int64_t j;
+
+    if ( table == NULL )
+    {
+      fail = 1;
+      continue;
+    }
+
+    for ( j=0; ok && j<sampleSize; j++ )
+      /* skip zeros and immediate repeats; label data runs long */
+      if ( p[j] != 0 && p[j] != last )
+      {
+        last = p[j];
+        if ( !idInsert ( &table, &logcap, &count, p[j] ) )
+        {
+          fail = 1;
+          ok = 0;
+        }
+      }
+
+    if ( ok )
+    {
+      uint64_t * out = malloc ( (size_t)( count > 0 ? count : 1 ) * sizeof(uint64_t) );
+
+      if ( out == NULL )
+        fail = 1;
+      else
+      {
+        uint64_t cap = 1ULL << logcap, s;
+        int n = 0;
+
+        for ( s=0; s<cap; s++ )
+          if ( table[s] != 0 )
+            out[n++] = table[s];
+
+        qsort ( out, count, sizeof(uint64_t), cmpFunc64 );
+        sampleIds[t] = out;
+        counts[t] = count;
+      }
+    }
+    free ( table );
+  }
+
+  for ( t=0; t<timeSamples; t++ )
+    total += counts[t];
+
+  if ( fail || total > maxIds )
+  {
+    for ( t=0; t<timeSamples; t++ )
+      free ( sampleIds[t] );
+    free ( sampleIds );
+    free ( counts );
+    return -1;
+  }
+
+  offsets[0] = 0;
+  for ( t=0; t<timeSamples; t++ )
+  {
+    memcpy ( ids + offsets[t], sampleIds[t], (size_t)counts[t] * sizeof(uint64_t) );
+    offsets[t+1] = offsets[t] + counts[t];
+    free ( sampleIds[t] );
+  }
+  free ( sampleIds );
+  free ( counts );
+
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_UNIQUE, (uint64_t)timeSamples * sampleSize );
+  return total;
+}
+
+/*
+ * Parallel per-id voxel histogram kernel
+ *
+ * Counts the voxels of every non-zero id in a uint64 cuboid in one
+ * pass, without the full sort that unique + np.unique(return_counts)
+ * pays just to count. Fixed-size voxel chunks build thread-local
+ * (id, count) hash tables, then the merge itself runs in parallel:
+ * each thread owns a stripe of the id space by hash and sums that
+ * stripe across every table into its own output run, so no stripe is
+ * touched twice. A final sort over the distinct ids (bounded by
+ * maxIds, not by dataSize) orders the packed (ids, counts) arrays.
+ *
+ * Returns the number of distinct non-zero ids, or -1 when a table
+ * could not be allocated or more than maxIds distinct ids were seen.
+ */
+
+typedef struct
+{
+  uint64_t id;
+  uint64_t count;
+} HistEntry;
+
+static int cmpHistEntry ( const void * pa, const void * pb )
+{
+  uint64_t a = ((const HistEntry*)pa)->id;
+  uint64_t b = ((const HistEntry*)pb)->id;
+  return ( a > b ) - ( a < b );
+}
+
+// Insert or extend one id in a thread-local table. Returns 0 when the
+// table is full and could not be grown.
+static int histInsert ( HistEntry ** table, int * logcap, int * count,
+                        uint64_t id, uint64_t add )
+{
+  HistEntry * t = *table;
+  uint64_t mask = ( 1ULL << *logcap ) - 1;
+  uint64_t slot = ( id * 0x9E3779B97F4A7C15ULL ) >> ( 64 - *logcap );
+
+  while ( t[slot].id != 0 && t[slot].id != id )
+    slot = ( slot + 1 ) & mask;
+
+  if ( t[slot].id == id )
+  {
+    t[slot].count += add;
+    return 1;
+  }
+
+  t[slot].id = id;
+  t[slot].count = add;
+  *count += 1;
+
+  /* grow at 70% load so probe chains stay short */
+  if ( (uint64_t)*count * 10 > ( mask + 1 ) * 7 )
+  {
+    int newlog = *logcap + 1;
+    HistEntry * grown = calloc ( 1ULL << newlog, sizeof(HistEntry) );
+    uint64_t i;
+
+    if ( grown == NULL )
+      return 0;
+
+    for ( i=0; i<=mask; i++ )
+      if ( t[i].id != 0 )
+      {
+        uint64_t s = ( t[i].id * 0x9E3779B97F4A7C15ULL ) >> ( 64 - newlog );
+        uint64_t newmask = ( 1ULL << newlog ) - 1;
+        while ( grown[s].id != 0 )
+          s = ( s + 1 ) & newmask;
+        grown[s] = t[i];
+      }
+
+    free ( t );
+    *table = grown;
+    *logcap = newlog;
+  }
+
+  return 1;
+}
+
+int idHistogramOMP ( uint64_t * data, int64_t dataSize, int maxIds,
+                     uint64_t * ids, uint64_t * counts )
+{
+  int64_t nChunks = ( dataSize + IDS_CHUNK_VOXELS - 1 ) / IDS_CHUNK_VOXELS;
+
+  int nthreads = omp_get_max_threads();
+  if ( (int64_t)nthreads > nChunks )
+    nthreads = (int)nChunks;
+  if ( nthreads < 1 )
+    nthreads = 1;
+
+  HistEntry ** tables = calloc ( nthreads, sizeof(HistEntry*) );
+  int * logcaps = malloc ( nthreads * sizeof(int) );
+  HistEntry ** stripes = calloc ( nthreads, sizeof(HistEntry*) );
+  int * stripeCounts = calloc ( nthreads, sizeof(int) );
+  HistEntry * merged = NULL;
+  int fail = 0, total = 0, t, index;
+  NDLIB_STAT_START ( statT0 );
+
+  if ( tables == NULL || logcaps == NULL || stripes == NULL || stripeCounts == NULL )
+  {
+    free ( tables );
+    free ( logcaps );
+    free ( stripes );
+    free ( stripeCounts );
+    return -1;
+  }
+
+#pragma omp parallel num_threads(nthreads)
+  {
+    int tid = omp_get_thread_num();
+    int64_t chunk;
+    int tcount = 0, ok;
+
+    /* fail is shared: a failed thread must stop its teammates from
+     * dereferencing its NULL table in the merge phase, and every thread
+     * must still encounter the worksharing loop below, so the flag is
+     * written atomically and becomes visible at the loop's implicit
+     * barrier */
+    logcaps[tid] = 10;
+    tables[tid] = calloc ( 1ULL << logcaps[tid], sizeof(HistEntry) );
+    if ( tables[tid] == NULL )
+    {
+#pragma omp atomic write
+      fail = 1;
+    }
+    ok = ( tables[tid] != NULL );
+
+#pragma omp for schedule(static)
+    for ( chunk=0; chunk<nChunks; chunk++ )
+    {
+      int64_t pos = chunk * IDS_CHUNK_VOXELS;
+      int64_t end = pos + IDS_CHUNK_VOXELS;
+      int64_t j;
+      if ( end > dataSize )
+        end = dataSize;
+
+      /* accumulate runs of the same id locally; label data runs long */
+      uint64_t last = 0, run = 0;
+      for ( j=pos; ok && j<end; j++ )
+      {
+        if ( data[j] == last )
+        {
+          run += ( last != 0 );
+          continue;
+        }
+        if ( last != 0 && !histInsert ( &tables[tid], &logcaps[tid], &tcount, last, run ) )
+        {
+#pragma omp atomic write
+          fail = 1;
+          ok = 0;
+          break;
+        }
+        last = data[j];
+        run = ( last != 0 );
+      }
+      if ( ok && last != 0 && !histInsert ( &tables[tid], &logcaps[tid], &tcount, last, run ) )
+      {
+#pragma omp atomic write
+        fail = 1;
+        ok = 0;
+      }
+    }
+
+    /* parallel merge: each thread owns a stripe of the id space by hash
+     * and folds that stripe across every table into its own run; the
+     * implicit barrier of the loop above already published fail */
+    if ( !fail )
+    {
+      HistEntry * stripe = NULL;
+      int slog = 8, scount = 0, s;
+
+      stripe = calloc ( 1ULL << slog, sizeof(HistEntry) );
+      if ( stripe == NULL )
+      {
+#pragma omp atomic write
+        fail = 1;
+      }
+
+      for ( s=0; !fail && s<nthreads; s++ )
+      {
+        uint64_t cap = 1ULL << logcaps[s], i;
+        for ( i=0; !fail && i<cap; i++ )
+        {
+          uint64_t id = tables[s][i].id;
+          if ( id != 0 &&
+               (int)( ( ( id * 0x9E3779B97F4A7C15ULL ) >> 32 ) % (uint64_t)nthreads ) == tid &&
+               !histInsert ( &stripe, &slog, &scount, id, tables[s][i].count ) )
+          {
+#pragma omp atomic write
+            fail = 1;
+          }
+        }
+      }
+
+      if ( !fail )
+      {
+        HistEntry * packed = malloc ( (size_t)( scount > 0 ? scount : 1 ) * sizeof(HistEntry) );
+        if ( packed == NULL )
+        {
+#pragma omp atomic write
+          fail = 1;
+        }
+        else
+        {
+          uint64_t cap = 1ULL << slog, i;
+          int n = 0;
+          for ( i=0; i<cap; i++ )
+            if ( stripe[i].id != 0 )
+              packed[n++] = stripe[i];
+          stripes[tid] = packed;
+          stripeCounts[tid] = scount;
+        }
+      }
+      free ( stripe );
+    }
+  }
+
+  for ( t=0; t<nthreads; t++ )
+  {
+    total += stripeCounts[t];
+    free ( tables[t] );
+  }
+  free ( tables );
+  free ( logcaps );
+
+  if ( !fail && total <= maxIds )
+    merged = malloc ( (size_t)( total > 0 ? total : 1 ) * sizeof(HistEntry) );
+
+  if ( fail || total > maxIds || merged == NULL )
+  {
+    for ( t=0; t<nthreads; t++ )
+      free ( stripes[t] );
+    free ( stripes );
+    free ( stripeCounts );
+    free ( merged );
+    return -1;
+  }
+
+  index = 0;
+  for ( t=0; t<nthreads; t++ )
+  {
+    memcpy ( merged + index, stripes[t], (size_t)stripeCounts[t] * sizeof(HistEntry) );
+    index += stripeCounts[t];
+    free ( stripes[t] );
+  }
+  free ( stripes );
+  free ( stripeCounts );
+
+  /* sort over distinct ids only, bounded by maxIds rather than dataSize */
+  qsort ( merged, total, sizeof(HistEntry), cmpHistEntry );
+
+  for ( t=0; t<total; t++ )
+  {
+    ids[t] = merged[t].id;
+    counts[t] = merged[t].count;
+  }
+  free ( merged );
+
+  NDLIB_STAT_END ( statT0, NDLIB_STAT_UNIQUE, (uint64_t)dataSize );
+  return total;
+}
@@ -21,10 +21,153 @@
  */
 
 #include<stdint.h>
+#include<stddef.h>
 #include<math.h>
 #include<omp.h>
 #include<ndlib.h>
 
+/*
+ * Multi-versioned row kernels
+ *
+ * The per-row sample loops of the OMP zoom kernels carry baseline, AVX2
+ * and AVX-512 bodies and pick the widest one the host supports through
+ * ndlibCpuFeatures, so the shared ndlib.so needs no -march flags. The
+ * zoom factor is always a power of two, so a row indexes its source by
+ * shift and the wide bodies turn the strided (zoom out) or repeated
+ * (zoom in) reads into gathers. 32-bit rows only: there is no 16-bit
+ * gather, so the 16-bit zoom-in row stays scalar.
+ */
+
+static void zoomOutRow32Base ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+  int k;
+  for ( k=0; k<outx; k++ )
+    dst[k] = src[ (size_t)k << shift ];
+}
+
+static void zoomInRow32Base ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+  int k;
+  for ( k=0; k<outx; k++ )
+    dst[k] = src[ k >> shift ];
+}
+
+static void zoomInRow16 ( const uint16_t * src, uint16_t * dst, int outx, int shift )
+{
+  int k;
+  for ( k=0; k<outx; k++ )
+    dst[k] = src[ k >> shift ];
+}
+
+#if defined(__x86_64__)
+#include<immintrin.h>
+
+__attribute__((target("avx2")))
+static void zoomOutRow32AVX2 ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+  int k;
+  __m128i vshift = _mm_cvtsi32_si128 ( shift );
+  __m256i lane = _mm256_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7 );
+
+  for ( k=0; k+8<=outx; k+=8 )
+  {
+    __m256i idx = _mm256_sll_epi32 ( _mm256_add_epi32 ( _mm256_set1_epi32 ( k ), lane ), vshift );
+    _mm256_storeu_si256 ( (__m256i*)(dst+k), _mm256_i32gather_epi32 ( (const int*)src, idx, 4 ) );
+  }
+
+  for ( ; k<outx; k++ )
+    dst[k] = src[ (size_t)k << shift ];
+}
+
+__attribute__((target("avx512f")))
+static void zoomOutRow32AVX512 ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+  int k;
+  __m128i vshift = _mm_cvtsi32_si128 ( shift );
+  __m512i lane = _mm512_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+
+  for ( k=0; k+16<=outx; k+=16 )
+  {
+    __m512i idx = _mm512_sll_epi32 ( _mm512_add_epi32 ( _mm512_set1_epi32 ( k ), lane ), vshift );
+    _mm512_storeu_si512 ( (void*)(dst+k), _mm512_i32gather_epi32 ( idx, (const void*)src, 4 ) );
+  }
+
+  for ( ; k<outx; k++ )
+    dst[k] = src[ (size_t)k << shift ];
+}
+
+__attribute__((target("avx2")))
+static void zoomInRow32AVX2 ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+  int k;
+  __m128i vshift = _mm_cvtsi32_si128 ( shift );
+  __m256i lane = _mm256_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7 );
+
+  for ( k=0; k+8<=outx; k+=8 )
+  {
+    __m256i idx = _mm256_srl_epi32 ( _mm256_add_epi32 ( _mm256_set1_epi32 ( k ), lane ), vshift );
+    _mm256_storeu_si256 ( (__m256i*)(dst+k), _mm256_i32gather_epi32 ( (const int*)src, idx, 4 ) );
+  }
+
+  for ( ; k<outx; k++ )
+    dst[k] = src[ k >> shift ];
+}
+
+__attribute__((target("avx512f")))
+static void zoomInRow32AVX512 ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+  int k;
+  __m128i vshift = _mm_cvtsi32_si128 ( shift );
+  __m512i lane = _mm512_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+
+  for ( k=0; k+16<=outx; k+=16 )
+  {
+    __m512i idx = _mm512_srl_epi32 ( _mm512_add_epi32 ( _mm512_set1_epi32 ( k ), lane ), vshift );
+    _mm512_storeu_si512 ( (void*)(dst+k), _mm512_i32gather_epi32 ( idx, (const void*)src, 4 ) );
+  }
+
+  for ( ; k<outx; k++ )
+    dst[k] = src[ k >> shift ];
+}
+
+#endif /* __x86_64__ */
+
+static void zoomOutRow32 ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+#if defined(__x86_64__)
+  int cpu = ndlibCpuFeatures ();
+  if ( cpu & NDLIB_CPU_AVX512F )
+  {
+    zoomOutRow32AVX512 ( src, dst, outx, shift );
+    return;
+  }
+  if ( cpu & NDLIB_CPU_AVX2 )
+  {
+    zoomOutRow32AVX2 ( src, dst, outx, shift );
+    return;
+  }
+#endif
+  zoomOutRow32Base ( src, dst, outx, shift );
+}
+
+static void zoomInRow32 ( const uint32_t * src, uint32_t * dst, int outx, int shift )
+{
+#if defined(__x86_64__)
+  int cpu = ndlibCpuFeatures ();
+  if ( cpu & NDLIB_CPU_AVX512F )
+  {
+    zoomInRow32AVX512 ( src, dst, outx, shift );
+    return;
+  }
+  if ( cpu & NDLIB_CPU_AVX2 )
+  {
+    zoomInRow32AVX2 ( src, dst, outx, shift );
+    return;
+  }
+#endif
+  zoomInRow32Base ( src, dst, outx, shift );
+}
+
 // Zoom Out 32bit Naive
 void zoomOutData( uint32_t * olddata, uint32_t * newdata, int * dims, int factor )
 {
@@ -50,26 +193,22 @@ void zoomOutData( uint32_t * olddata, uint32_t * newdata, int * dims, int factor
 // Zoom out 32bit OpenMP
 void zoomOutDataOMP( uint32_t * olddata, uint32_t * newdata, int * dims, int factor )
 {
-		int i,j,k;
+		int i,j;
 
     int zdim = dims[0];
     int ydim = dims[1];
     int xdim = dims[2];
-   
-    int oldindex,newindex;
+
     int power = pow(2,factor);
 
 #pragma omp parallel num_threads(omp_get_max_threads())
     {
-#pragma omp for private(i,j,k) schedule(dynamic)
+#pragma omp for private(i,j) schedule(dynamic)
       for ( i=0; i<zdim; i++ )
         for ( j=0; j<ydim; j++ )
-          for ( k=0; k<xdim; k++ )
-          {
-            newindex = (i*xdim*ydim)+(j*xdim)+(k);
-            oldindex = ( i*(xdim*power)*(ydim*power) ) + ( (j*power)*(xdim*power) ) + ( k*power );
-            newdata[newindex] = olddata[oldindex];
-          }
+          zoomOutRow32 ( olddata + ( i*(xdim*power)*(ydim*power) ) + ( (j*power)*(xdim*power) ),
+                         newdata + (i*xdim*ydim) + (j*xdim),
+                         xdim, factor );
     }
 }
 
@@ -98,51 +237,93 @@ void zoomInData( uint32_t * olddata, uint32_t * newdata, int * dims, int factor
 // Zoom In 16 bit OMP
 void zoomInDataOMP16( uint16_t * olddata, uint16_t * newdata, int * dims, int factor )
 {
-		int i,j,k;
+		int i,j;
 
     int zdim = dims[0];
     int ydim = dims[1];
     int xdim = dims[2];
-   
-    int oldindex, newindex;
+
     int power = pow(2,factor);
 
 #pragma omp parallel num_threads(omp_get_max_threads())
     {
-#pragma omp for private(i,j,k) schedule(dynamic)
+#pragma omp for private(i,j) schedule(dynamic)
       for ( i=0; i<zdim; i++ )
         for ( j=0; j<ydim; j++ )
-          for ( k=0; k<xdim; k++ )
-          {
-            newindex = (i*xdim*ydim)+(j*xdim)+(k);
-            oldindex = ( i*(xdim/power)*(ydim/power) ) + ( (j/power)*(xdim/power) ) + ( k/power );
-            newdata[newindex] = olddata[oldindex];
-          }
+          zoomInRow16 ( olddata + ( i*(xdim/power)*(ydim/power) ) + ( (j/power)*(xdim/power) ),
+                        newdata + (i*xdim*ydim) + (j*xdim),
+                        xdim, factor );
     }
 }
 
 // Zoom In 32 bit OMP
 void zoomInDataOMP32( uint32_t * olddata, uint32_t * newdata, int * dims, int factor )
 {
-		int i,j,k;
+		int i,j;
 
     int zdim = dims[0];
     int ydim = dims[1];
     int xdim = dims[2];
-   
-    int oldindex, newindex;
+
     int power = pow(2,factor);
 
 #pragma omp parallel num_threads(omp_get_max_threads())
     {
-#pragma omp for private(i,j,k) schedule(dynamic)
+#pragma omp for private(i,j) schedule(dynamic)
       for ( i=0; i<zdim; i++ )
         for ( j=0; j<ydim; j++ )
-          for ( k=0; k<xdim; k++ )
-          {
-            newindex = (i*xdim*ydim)+(j*xdim)+(k);
-            oldindex = ( i*(xdim/power)*(ydim/power) ) + ( (j/power)*(xdim/power) ) + ( k/power );
-            newdata[newindex] = olddata[oldindex];
-          }
+          zoomInRow32 ( olddata + ( i*(xdim/power)*(ydim/power) ) + ( (j/power)*(xdim/power) ),
+                        newdata + (i*xdim*ydim) + (j*xdim),
+                        xdim, factor );
     }
 }
+
+/*
+ * Fused multi-level downsample engine
+ *
+ * Emits every coarser resolution level of a base cuboid in one blocked
+ * pass: each z slice cascades level by level, so level N is sampled from
+ * the level N-1 rows that were just written and are still in cache,
+ * instead of re-reading the base data once per level. Matches the
+ * zoomOutData semantics exactly - point sampling, x and y halved per
+ * level, z preserved - so levels[k] equals zoomOutData with factor k+1.
+ *
+ * levels[k] must be sized (zdim, ydim>>(k+1), xdim>>(k+1)) and dims holds
+ * the base cuboid extents as [z, y, x].
+ */
+
+#define GEN_BUILD_PYRAMID( NAME, TYPE )                                        \
+void NAME ( TYPE * base, TYPE ** levels, int nLevels, int * dims )             \
+{                                                                              \
+  int zdim = dims[0];                                                          \
+  int ydim = dims[1];                                                          \
+  int xdim = dims[2];                                                          \
+  int i;                                                                       \
+                                                                               \
+  _Pragma ( "omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)" ) \
+  for ( i=0; i<zdim; i++ )                                                     \
+  {                                                                            \
+    int level, j, k;                                                           \
+    TYPE * src = base + (size_t)i * ydim * xdim;                               \
+    int srcx = xdim;                                                           \
+                                                                               \
+    for ( level=0; level<nLevels; level++ )                                    \
+    {                                                                          \
+      int outy = ydim >> ( level + 1 );                                        \
+      int outx = xdim >> ( level + 1 );                                        \
+      TYPE * dst = levels[level] + (size_t)i * outy * outx;                    \
+                                                                               \
+      for ( j=0; j<outy; j++ )                                                 \
+        for ( k=0; k<outx; k++ )                                               \
+          dst[ (j*outx)+(k) ] = src[ ((j*2)*srcx)+(k*2) ];                     \
+                                                                               \
+      src = dst;                                                               \
+      srcx = outx;                                                             \
+    }                                                                          \
+  }                                                                            \
+}
+
+GEN_BUILD_PYRAMID ( buildResolutionPyramid8, uint8_t )
+GEN_BUILD_PYRAMID ( buildResolutionPyramid16, uint16_t )
+GEN_BUILD_PYRAMID ( buildResolutionPyramid32, uint32_t )
+GEN_BUILD_PYRAMID ( buildResolutionPyramid64, uint64_t )
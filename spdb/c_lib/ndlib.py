@@ -39,15 +39,20 @@ except IndexError:
 array_1d_uint8 = npct.ndpointer(dtype=np.uint8, ndim=1, flags='C_CONTIGUOUS')
 array_2d_uint8 = npct.ndpointer(dtype=np.uint8, ndim=2, flags='C_CONTIGUOUS')
 array_3d_uint8 = npct.ndpointer(dtype=np.uint8, ndim=3, flags='C_CONTIGUOUS')
+array_4d_uint8 = npct.ndpointer(dtype=np.uint8, ndim=4, flags='C_CONTIGUOUS')
 array_1d_uint16 = npct.ndpointer(dtype=np.uint16, ndim=1, flags='C_CONTIGUOUS')
 array_2d_uint16 = npct.ndpointer(dtype=np.uint16, ndim=2, flags='C_CONTIGUOUS')
 array_3d_uint16 = npct.ndpointer(dtype=np.uint16, ndim=3, flags='C_CONTIGUOUS')
+array_4d_uint16 = npct.ndpointer(dtype=np.uint16, ndim=4, flags='C_CONTIGUOUS')
 array_1d_uint32 = npct.ndpointer(dtype=np.uint32, ndim=1, flags='C_CONTIGUOUS')
 array_2d_uint32 = npct.ndpointer(dtype=np.uint32, ndim=2, flags='C_CONTIGUOUS')
 array_3d_uint32 = npct.ndpointer(dtype=np.uint32, ndim=3, flags='C_CONTIGUOUS')
+array_4d_uint32 = npct.ndpointer(dtype=np.uint32, ndim=4, flags='C_CONTIGUOUS')
 array_1d_uint64 = npct.ndpointer(dtype=np.uint64, ndim=1, flags='C_CONTIGUOUS')
 array_2d_uint64 = npct.ndpointer(dtype=np.uint64, ndim=2, flags='C_CONTIGUOUS')
 array_3d_uint64 = npct.ndpointer(dtype=np.uint64, ndim=3, flags='C_CONTIGUOUS')
+array_4d_uint64 = npct.ndpointer(dtype=np.uint64, ndim=4, flags='C_CONTIGUOUS')
+array_1d_int64 = npct.ndpointer(dtype=np.int64, ndim=1, flags='C_CONTIGUOUS')
 array_2d_float32 = npct.ndpointer(dtype=np.float32, ndim=2, flags='C_CONTIGUOUS')
 
 # defining the parameter types of the functions in C
@@ -56,37 +61,225 @@ array_2d_float32 = npct.ndpointer(dtype=np.float32, ndim=2, flags='C_CONTIGUOUS'
 ndlib_ctypes.filterCutout.argtypes = [array_1d_uint32, cp.c_int, array_1d_uint32, cp.c_int]
 ndlib_ctypes.filterCutoutOMP32.argtypes = [array_1d_uint32, cp.c_int, array_1d_uint32, cp.c_int]
 ndlib_ctypes.filterCutoutOMP64.argtypes = [array_1d_uint64, cp.c_int, array_1d_uint64, cp.c_int]
+ndlib_ctypes.filterCutoutOMP32L.argtypes = [array_1d_uint32, cp.c_int64, array_1d_uint32, cp.c_int]
+ndlib_ctypes.filterCutoutOMP64L.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint64, cp.c_int]
+ndlib_ctypes.filterCutoutOMP4D32.argtypes = [array_4d_uint32, cp.c_int, cp.c_int64, cp.POINTER(cp.c_int),
+                                             array_1d_uint32, cp.c_int]
+ndlib_ctypes.filterCutoutOMP4D64.argtypes = [array_4d_uint64, cp.c_int, cp.c_int64, cp.POINTER(cp.c_int),
+                                             array_1d_uint64, cp.c_int]
+ndlib_ctypes.filterCutoutSIMD32.argtypes = [array_1d_uint32, cp.c_int, array_1d_uint32, cp.c_int]
+ndlib_ctypes.filterCutoutSIMD64.argtypes = [array_1d_uint64, cp.c_int, array_1d_uint64, cp.c_int]
+ndlib_ctypes.filterCutoutRange32.argtypes = [array_1d_uint32, cp.c_int, cp.c_uint32, cp.c_uint32]
+ndlib_ctypes.filterCutoutRange64.argtypes = [array_1d_uint64, cp.c_int, cp.c_uint64, cp.c_uint64]
+ndlib_ctypes.filterCutoutBitmap32.argtypes = [array_1d_uint32, cp.c_int, array_1d_uint8, cp.c_uint32]
+ndlib_ctypes.filterCutoutBitmap64.argtypes = [array_1d_uint64, cp.c_int, array_1d_uint8, cp.c_uint64]
+ndlib_ctypes.filterCutoutOMPCache.argtypes = [array_1d_uint32, cp.c_int, array_1d_uint32, cp.c_int]
+ndlib_ctypes.filterCutoutOMPCache64.argtypes = [array_1d_uint64, cp.c_int, array_1d_uint64, cp.c_int]
 ndlib_ctypes.locateCube.argtypes = [array_2d_uint64, cp.c_int, array_2d_uint32, cp.c_int, cp.POINTER(cp.c_int)]
+ndlib_ctypes.locateAndSortCube.argtypes = [array_2d_uint64, cp.c_int, array_2d_uint32, cp.c_int, cp.POINTER(cp.c_int)]
 ndlib_ctypes.annotateCube.argtypes = [array_1d_uint32, cp.c_int, cp.POINTER(cp.c_int), cp.c_int, array_1d_uint32,
                                       array_2d_uint32, cp.c_int, cp.c_char, array_2d_uint32]
+ndlib_ctypes.annotateCube8.argtypes = [array_1d_uint8, cp.c_int, cp.POINTER(cp.c_int), cp.c_uint8, array_1d_uint32,
+                                       array_2d_uint32, cp.c_int, cp.c_char, array_2d_uint32]
+ndlib_ctypes.annotateCube16.argtypes = [array_1d_uint16, cp.c_int, cp.POINTER(cp.c_int), cp.c_uint16, array_1d_uint32,
+                                        array_2d_uint32, cp.c_int, cp.c_char, array_2d_uint32]
+ndlib_ctypes.annotateCube64.argtypes = [array_1d_uint64, cp.c_int, cp.POINTER(cp.c_int), cp.c_uint64, array_1d_uint32,
+                                        array_2d_uint32, cp.c_int, cp.c_char, array_2d_uint32]
+ndlib_ctypes.annotateCubeBatch.argtypes = [array_1d_uint32, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint32,
+                                           array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                           cp.c_char, array_2d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.annotateCubeBatch8.argtypes = [array_1d_uint8, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint8,
+                                            array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                            cp.c_char, array_2d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.annotateCubeBatch16.argtypes = [array_1d_uint16, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint16,
+                                             array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                             cp.c_char, array_2d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.annotateCubeBatch64.argtypes = [array_1d_uint64, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint64,
+                                             array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                             cp.c_char, array_2d_uint32, cp.POINTER(cp.c_int)]
 ndlib_ctypes.XYZMorton.argtypes = [array_1d_uint64]
 ndlib_ctypes.MortonXYZ.argtypes = [npct.ctypes.c_int64, array_1d_uint64]
+ndlib_ctypes.XYZMortonBatch.argtypes = [array_2d_uint64, cp.c_int, array_1d_uint64]
+ndlib_ctypes.MortonXYZBatch.argtypes = [array_1d_uint64, cp.c_int, array_2d_uint64]
+# to/fromMortonLayout relayout raw bytes, so the buffers are untyped pointers
+ndlib_ctypes.toMortonLayout.argtypes = [cp.c_void_p, cp.c_void_p, cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.fromMortonLayout.argtypes = [cp.c_void_p, cp.c_void_p, cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.downsampleMortonVote64.argtypes = [array_1d_uint64, array_1d_uint64, cp.c_int64, cp.c_int]
 ndlib_ctypes.recolorCubeOMP32.argtypes = [ array_2d_uint32, cp.c_int, cp.c_int, array_2d_uint32, array_1d_uint32 ]
 ndlib_ctypes.recolorCubeOMP64.argtypes = [ array_2d_uint64, cp.c_int, cp.c_int, array_2d_uint64, array_1d_uint64 ]
+ndlib_ctypes.recolorSliceRGBA32.argtypes = [array_2d_uint32, cp.c_int, array_2d_uint32, array_1d_uint32]
+ndlib_ctypes.recolorSliceRGBA64.argtypes = [array_2d_uint64, cp.c_int, array_2d_uint32, array_1d_uint32]
+ndlib_ctypes.renderTile32.argtypes = [array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int, cp.c_int,
+                                      array_2d_uint32, array_1d_uint32]
+ndlib_ctypes.renderTile64.argtypes = [array_3d_uint64, cp.POINTER(cp.c_int), cp.c_int, cp.c_int,
+                                      array_2d_uint32, array_1d_uint32]
 ndlib_ctypes.quicksort.argtypes = [array_2d_uint64, cp.c_int]
 ndlib_ctypes.shaveCube.argtypes = [array_1d_uint32, cp.c_int, cp.POINTER(cp.c_int), cp.c_int, array_1d_uint32, array_2d_uint32,
                                    cp.c_int, array_2d_uint32, cp.c_int, array_2d_uint32]
+ndlib_ctypes.shaveCube8.argtypes = [array_1d_uint8, cp.c_int, cp.POINTER(cp.c_int), cp.c_uint8, array_1d_uint32, array_2d_uint32,
+                                    cp.c_int, array_2d_uint32, cp.c_int, array_2d_uint32]
+ndlib_ctypes.shaveCube16.argtypes = [array_1d_uint16, cp.c_int, cp.POINTER(cp.c_int), cp.c_uint16, array_1d_uint32, array_2d_uint32,
+                                     cp.c_int, array_2d_uint32, cp.c_int, array_2d_uint32]
+ndlib_ctypes.shaveCube64.argtypes = [array_1d_uint64, cp.c_int, cp.POINTER(cp.c_int), cp.c_uint64, array_1d_uint32, array_2d_uint32,
+                                     cp.c_int, array_2d_uint32, cp.c_int, array_2d_uint32]
+ndlib_ctypes.shaveCubeBatch.argtypes = [array_1d_uint32, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint32,
+                                        array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                        array_2d_uint32, cp.POINTER(cp.c_int), array_2d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.shaveCubeBatch8.argtypes = [array_1d_uint8, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint8,
+                                         array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                         array_2d_uint32, cp.POINTER(cp.c_int), array_2d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.shaveCubeBatch16.argtypes = [array_1d_uint16, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint16,
+                                          array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                          array_2d_uint32, cp.POINTER(cp.c_int), array_2d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.shaveCubeBatch64.argtypes = [array_1d_uint64, cp.c_int, cp.POINTER(cp.c_int), array_1d_uint64,
+                                          array_1d_uint32, array_2d_uint32, cp.POINTER(cp.c_int), cp.c_int,
+                                          array_2d_uint32, cp.POINTER(cp.c_int), array_2d_uint32, cp.POINTER(cp.c_int)]
 ndlib_ctypes.annotateEntityDense.argtypes = [array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.annotateEntityDense8.argtypes = [array_3d_uint8, cp.POINTER(cp.c_int), cp.c_uint8]
+ndlib_ctypes.annotateEntityDense16.argtypes = [array_3d_uint16, cp.POINTER(cp.c_int), cp.c_uint16]
+ndlib_ctypes.annotateEntityDense64.argtypes = [array_3d_uint64, cp.POINTER(cp.c_int), cp.c_uint64]
 ndlib_ctypes.shaveDense.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.shaveDense8.argtypes = [array_3d_uint8, array_3d_uint8, cp.POINTER(cp.c_int)]
+ndlib_ctypes.shaveDense16.argtypes = [array_3d_uint16, array_3d_uint16, cp.POINTER(cp.c_int)]
+ndlib_ctypes.shaveDense64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int)]
 ndlib_ctypes.exceptionDense.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int)]
+ndlib_ctypes.exceptionDense8.argtypes = [array_3d_uint8, array_3d_uint8, cp.POINTER(cp.c_int)]
+ndlib_ctypes.exceptionDense16.argtypes = [array_3d_uint16, array_3d_uint16, cp.POINTER(cp.c_int)]
+ndlib_ctypes.exceptionDense64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int)]
 ndlib_ctypes.overwriteDense.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int)]
 ndlib_ctypes.overwriteDense8.argtypes = [array_3d_uint8, array_3d_uint8, cp.POINTER(cp.c_int)]
 ndlib_ctypes.overwriteDense16.argtypes = [array_3d_uint16, array_3d_uint16, cp.POINTER(cp.c_int)]
 ndlib_ctypes.overwriteDense64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int)]
+ndlib_ctypes.overwriteDenseL.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int64)]
+ndlib_ctypes.overwriteDense8L.argtypes = [array_3d_uint8, array_3d_uint8, cp.POINTER(cp.c_int64)]
+ndlib_ctypes.overwriteDense16L.argtypes = [array_3d_uint16, array_3d_uint16, cp.POINTER(cp.c_int64)]
+ndlib_ctypes.overwriteDense64L.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int64)]
+ndlib_ctypes.overwriteDense4D.argtypes = [array_4d_uint32, array_4d_uint32, cp.c_int, cp.c_int64,
+                                          cp.POINTER(cp.c_int)]
+ndlib_ctypes.overwriteDense4D8.argtypes = [array_4d_uint8, array_4d_uint8, cp.c_int, cp.c_int64,
+                                           cp.POINTER(cp.c_int)]
+ndlib_ctypes.overwriteDense4D16.argtypes = [array_4d_uint16, array_4d_uint16, cp.c_int, cp.c_int64,
+                                            cp.POINTER(cp.c_int)]
+ndlib_ctypes.overwriteDense4D64.argtypes = [array_4d_uint64, array_4d_uint64, cp.c_int, cp.c_int64,
+                                            cp.POINTER(cp.c_int)]
+# applyDenseOps walks the cuboid flat, so the buffers are untyped pointers
+ndlib_ctypes.applyDenseOps.argtypes = [cp.c_void_p, cp.POINTER(cp.c_void_p), cp.POINTER(cp.c_int),
+                                       cp.c_int, cp.c_int64]
+ndlib_ctypes.applyDenseOps8.argtypes = [cp.c_void_p, cp.POINTER(cp.c_void_p), cp.POINTER(cp.c_int),
+                                        cp.c_int, cp.c_int64]
+ndlib_ctypes.applyDenseOps16.argtypes = [cp.c_void_p, cp.POINTER(cp.c_void_p), cp.POINTER(cp.c_int),
+                                         cp.c_int, cp.c_int64]
+ndlib_ctypes.applyDenseOps64.argtypes = [cp.c_void_p, cp.POINTER(cp.c_void_p), cp.POINTER(cp.c_int),
+                                         cp.c_int, cp.c_int64]
+ndlib_ctypes.overwriteDenseDirty.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), array_1d_uint8]
+ndlib_ctypes.overwriteDenseDirty8.argtypes = [array_3d_uint8, array_3d_uint8, cp.POINTER(cp.c_int), array_1d_uint8]
+ndlib_ctypes.overwriteDenseDirty16.argtypes = [array_3d_uint16, array_3d_uint16, cp.POINTER(cp.c_int), array_1d_uint8]
+ndlib_ctypes.overwriteDenseDirty64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int), array_1d_uint8]
 ndlib_ctypes.zoomOutData.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int]
 ndlib_ctypes.zoomOutDataOMP.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int]
 ndlib_ctypes.zoomInData.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int]
+# buildResolutionPyramid writes a list of per-level cuboids, so the outputs are untyped pointers
+ndlib_ctypes.buildResolutionPyramid8.argtypes = [array_3d_uint8, cp.POINTER(cp.c_void_p), cp.c_int,
+                                                 cp.POINTER(cp.c_int)]
+ndlib_ctypes.buildResolutionPyramid16.argtypes = [array_3d_uint16, cp.POINTER(cp.c_void_p), cp.c_int,
+                                                  cp.POINTER(cp.c_int)]
+ndlib_ctypes.buildResolutionPyramid32.argtypes = [array_3d_uint32, cp.POINTER(cp.c_void_p), cp.c_int,
+                                                  cp.POINTER(cp.c_int)]
+ndlib_ctypes.buildResolutionPyramid64.argtypes = [array_3d_uint64, cp.POINTER(cp.c_void_p), cp.c_int,
+                                                  cp.POINTER(cp.c_int)]
 ndlib_ctypes.zoomInDataOMP16.argtypes = [array_3d_uint16, array_3d_uint16, cp.POINTER(cp.c_int), cp.c_int]
 ndlib_ctypes.zoomInDataOMP32.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.zoomOutDataOMPL.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int64), cp.c_int]
+ndlib_ctypes.zoomInDataOMPL.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int64), cp.c_int]
 ndlib_ctypes.mergeCube.argtypes = [array_3d_uint32, cp.POINTER(cp.c_int), cp.c_int, cp.c_int]
+ndlib_ctypes.mergeCube8.argtypes = [array_3d_uint8, cp.POINTER(cp.c_int), cp.c_uint8, cp.c_uint8]
+ndlib_ctypes.mergeCube16.argtypes = [array_3d_uint16, cp.POINTER(cp.c_int), cp.c_uint16, cp.c_uint16]
+ndlib_ctypes.mergeCube64.argtypes = [array_3d_uint64, cp.POINTER(cp.c_int), cp.c_uint64, cp.c_uint64]
+ndlib_ctypes.mergeCubeBatch.argtypes = [array_3d_uint32, cp.c_int64, array_1d_uint32, array_1d_uint32,
+                                        cp.c_int]
+ndlib_ctypes.mergeCubeBatch8.argtypes = [array_3d_uint8, cp.c_int64, array_1d_uint8, array_1d_uint8,
+                                         cp.c_int]
+ndlib_ctypes.mergeCubeBatch16.argtypes = [array_3d_uint16, cp.c_int64, array_1d_uint16, array_1d_uint16,
+                                          cp.c_int]
+ndlib_ctypes.mergeCubeBatch64.argtypes = [array_3d_uint64, cp.c_int64, array_1d_uint64, array_1d_uint64,
+                                          cp.c_int]
 ndlib_ctypes.isotropicBuild8.argtypes = [array_2d_uint8, array_2d_uint8, array_2d_uint8, cp.POINTER(cp.c_int)]
 ndlib_ctypes.isotropicBuild16.argtypes = [array_2d_uint16, array_2d_uint16, array_2d_uint16, cp.POINTER(cp.c_int)]
 ndlib_ctypes.isotropicBuild32.argtypes = [array_2d_uint32, array_2d_uint32, array_2d_uint32, cp.POINTER(cp.c_int)]
 ndlib_ctypes.isotropicBuildF32.argtypes = [array_2d_float32, array_2d_float32, array_2d_float32, cp.POINTER(cp.c_int)]
 ndlib_ctypes.addDataZSlice.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), cp.POINTER(cp.c_int)]
 ndlib_ctypes.addDataIsotropic.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int), cp.POINTER(cp.c_int)]
+ndlib_ctypes.addDataZSliceOMP.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int),
+                                          cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.addDataZSliceOMP64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int),
+                                            cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.addDataIsotropicOMP.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int),
+                                             cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.addDataIsotropicOMP64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int),
+                                               cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), cp.c_int]
+ndlib_ctypes.addDataZSliceOMPL.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int64),
+                                           cp.POINTER(cp.c_int64), cp.POINTER(cp.c_int64), cp.c_int]
+ndlib_ctypes.addDataZSliceOMPL64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int64),
+                                             cp.POINTER(cp.c_int64), cp.POINTER(cp.c_int64), cp.c_int]
+ndlib_ctypes.addDataIsotropicOMPL.argtypes = [array_3d_uint32, array_3d_uint32, cp.POINTER(cp.c_int64),
+                                              cp.POINTER(cp.c_int64), cp.POINTER(cp.c_int64), cp.c_int]
+ndlib_ctypes.addDataIsotropicOMPL64.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int64),
+                                                cp.POINTER(cp.c_int64), cp.POINTER(cp.c_int64), cp.c_int]
 ndlib_ctypes.addAnnotationData.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int), cp.POINTER(cp.c_int)]
+ndlib_ctypes.addAnnotationDataOMP.argtypes = [array_3d_uint64, array_3d_uint64, cp.POINTER(cp.c_int), cp.POINTER(cp.c_int)]
 ndlib_ctypes.unique.argtypes = [array_1d_uint64, array_1d_uint64, cp.c_int]
+ndlib_ctypes.uniqueOMP.argtypes = [array_1d_uint64, array_1d_uint64, cp.c_int]
+ndlib_ctypes.uniqueOMPL.argtypes = [array_1d_uint64, array_1d_uint64, cp.c_int64, cp.c_int]
+ndlib_ctypes.unique4D.argtypes = [array_4d_uint64, cp.c_int, cp.c_int64, cp.c_int64, cp.c_int,
+                                  array_1d_uint64, array_1d_int64]
+ndlib_ctypes.idHistogramOMP.argtypes = [array_1d_uint64, cp.c_int64, cp.c_int, array_1d_uint64,
+                                        array_1d_uint64]
+ndlib_ctypes.uniqueBBoxOMP.argtypes = [array_3d_uint64, cp.POINTER(cp.c_int), cp.c_int, array_1d_uint64,
+                                       array_2d_uint32]
+ndlib_ctypes.idsInRegionOMP.argtypes = [cp.POINTER(cp.c_void_p), cp.c_int, cp.c_int64, cp.c_int,
+                                        array_1d_uint64]
+# assembleCutout/sliceCutout move raw bytes, so the buffers are untyped pointers
+ndlib_ctypes.assembleCutout.argtypes = [cp.c_void_p, cp.POINTER(cp.c_void_p), array_1d_uint64, cp.c_int,
+                                        cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), array_1d_uint64,
+                                        cp.c_int, cp.c_int]
+ndlib_ctypes.sliceCutout.argtypes = [cp.c_void_p, cp.POINTER(cp.c_void_p), array_1d_uint64, cp.c_int,
+                                     cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), array_1d_uint64,
+                                     cp.c_int, cp.c_int]
+ndlib_ctypes.ndlibArenaCreate.argtypes = [cp.c_uint64]
+ndlib_ctypes.ndlibArenaAcquire.argtypes = [cp.c_void_p, cp.c_uint64]
+ndlib_ctypes.ndlibArenaRelease.argtypes = [cp.c_void_p]
+ndlib_ctypes.ndlibArenaDestroy.argtypes = [cp.c_void_p]
+ndlib_ctypes.ndlibInit.argtypes = [cp.c_int, cp.c_int]
+ndlib_ctypes.ndlibSetThreads.argtypes = [cp.c_int]
+ndlib_ctypes.ndlibGetThreads.argtypes = []
+ndlib_ctypes.ndlibCpuFeatures.argtypes = []
+ndlib_ctypes.ndlibCpuSetFeatures.argtypes = [cp.c_int]
+ndlib_ctypes.ndlibStatsEnabled.argtypes = []
+ndlib_ctypes.ndlibStatsSnapshot.argtypes = [array_2d_uint64]
+ndlib_ctypes.ndlibStatsReset.argtypes = []
+ndlib_ctypes.bloscAvailable.argtypes = []
+ndlib_ctypes.compressCuboid.argtypes = [cp.c_void_p, cp.c_uint64, cp.c_int, array_1d_uint8, cp.c_uint64]
+ndlib_ctypes.decompressCuboid.argtypes = [cp.c_char_p, cp.c_void_p, cp.c_uint64]
+ndlib_ctypes.rleEncode8.argtypes = [array_1d_uint8, cp.c_int64, array_1d_uint64, cp.c_int64]
+ndlib_ctypes.rleEncode16.argtypes = [array_1d_uint16, cp.c_int64, array_1d_uint64, cp.c_int64]
+ndlib_ctypes.rleEncode32.argtypes = [array_1d_uint32, cp.c_int64, array_1d_uint64, cp.c_int64]
+ndlib_ctypes.rleEncode64.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint64, cp.c_int64]
+ndlib_ctypes.rleDecode8.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint8]
+ndlib_ctypes.rleDecode16.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint16]
+ndlib_ctypes.rleDecode32.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint32]
+ndlib_ctypes.rleDecode64.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint64]
+ndlib_ctypes.rleFilter.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint64, cp.c_int]
+ndlib_ctypes.rleUnique.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint64, cp.c_int]
+ndlib_ctypes.rleOverwrite.argtypes = [array_1d_uint64, cp.c_int64, array_1d_uint64, cp.c_int64,
+                                      array_1d_uint64, cp.c_int64]
+ndlib_ctypes.cutoutPipelineCreate.argtypes = [cp.c_void_p, cp.POINTER(cp.c_int), cp.POINTER(cp.c_int),
+                                              array_1d_uint64, cp.c_int, cp.c_int, cp.c_int]
+ndlib_ctypes.cutoutPipelineSubmit.argtypes = [cp.c_void_p, cp.c_char_p, cp.c_uint64, cp.c_uint64]
+ndlib_ctypes.cutoutPipelineDrain.argtypes = [cp.c_void_p]
+ndlib_ctypes.cutoutPipelineDestroy.argtypes = [cp.c_void_p]
+ndlib_ctypes.decompressCutout.argtypes = [cp.c_void_p, cp.POINTER(cp.c_char_p), array_1d_uint64, cp.c_int,
+                                          cp.POINTER(cp.c_int), cp.POINTER(cp.c_int), array_1d_uint64,
+                                          cp.c_int, cp.c_int]
 
 # setting the return type of the function in C
 # FORMAT: <library_name>.<function_name>.restype = [ ctype.<argtype> ]
@@ -94,39 +287,185 @@ ndlib_ctypes.unique.argtypes = [array_1d_uint64, array_1d_uint64, cp.c_int]
 ndlib_ctypes.filterCutout.restype = None
 ndlib_ctypes.filterCutoutOMP32.restype = None
 ndlib_ctypes.filterCutoutOMP64.restype = None
+ndlib_ctypes.filterCutoutOMP32L.restype = None
+ndlib_ctypes.filterCutoutOMP64L.restype = None
+ndlib_ctypes.filterCutoutOMP4D32.restype = None
+ndlib_ctypes.filterCutoutOMP4D64.restype = None
+ndlib_ctypes.filterCutoutSIMD32.restype = None
+ndlib_ctypes.filterCutoutSIMD64.restype = None
+ndlib_ctypes.filterCutoutRange32.restype = None
+ndlib_ctypes.filterCutoutRange64.restype = None
+ndlib_ctypes.filterCutoutBitmap32.restype = None
+ndlib_ctypes.filterCutoutBitmap64.restype = None
+ndlib_ctypes.filterCutoutOMPCache.restype = None
+ndlib_ctypes.filterCutoutOMPCache64.restype = None
 ndlib_ctypes.locateCube.restype = None
+ndlib_ctypes.locateAndSortCube.restype = None
 ndlib_ctypes.annotateCube.restype = cp.c_int
+ndlib_ctypes.annotateCube8.restype = cp.c_int
+ndlib_ctypes.annotateCube16.restype = cp.c_int
+ndlib_ctypes.annotateCube64.restype = cp.c_int
+ndlib_ctypes.annotateCubeBatch.restype = None
+ndlib_ctypes.annotateCubeBatch8.restype = None
+ndlib_ctypes.annotateCubeBatch16.restype = None
+ndlib_ctypes.annotateCubeBatch64.restype = None
 ndlib_ctypes.XYZMorton.restype = npct.ctypes.c_uint64
 ndlib_ctypes.MortonXYZ.restype = None
+ndlib_ctypes.XYZMortonBatch.restype = None
+ndlib_ctypes.MortonXYZBatch.restype = None
+ndlib_ctypes.toMortonLayout.restype = cp.c_int
+ndlib_ctypes.fromMortonLayout.restype = cp.c_int
+ndlib_ctypes.downsampleMortonVote64.restype = None
 ndlib_ctypes.recolorCubeOMP32.restype = None
 ndlib_ctypes.recolorCubeOMP64.restype = None
+ndlib_ctypes.recolorSliceRGBA32.restype = None
+ndlib_ctypes.recolorSliceRGBA64.restype = None
+ndlib_ctypes.renderTile32.restype = None
+ndlib_ctypes.renderTile64.restype = None
 ndlib_ctypes.quicksort.restype = None
 ndlib_ctypes.shaveCube.restype = None
+ndlib_ctypes.shaveCube8.restype = None
+ndlib_ctypes.shaveCube16.restype = None
+ndlib_ctypes.shaveCube64.restype = None
+ndlib_ctypes.shaveCubeBatch.restype = None
+ndlib_ctypes.shaveCubeBatch8.restype = None
+ndlib_ctypes.shaveCubeBatch16.restype = None
+ndlib_ctypes.shaveCubeBatch64.restype = None
 ndlib_ctypes.annotateEntityDense.restype = None
+ndlib_ctypes.annotateEntityDense8.restype = None
+ndlib_ctypes.annotateEntityDense16.restype = None
+ndlib_ctypes.annotateEntityDense64.restype = None
 ndlib_ctypes.shaveDense.restype = None
+ndlib_ctypes.shaveDense8.restype = None
+ndlib_ctypes.shaveDense16.restype = None
+ndlib_ctypes.shaveDense64.restype = None
 ndlib_ctypes.exceptionDense.restype = None
+ndlib_ctypes.exceptionDense8.restype = None
+ndlib_ctypes.exceptionDense16.restype = None
+ndlib_ctypes.exceptionDense64.restype = None
 ndlib_ctypes.overwriteDense.restype = None
 ndlib_ctypes.overwriteDense8.restype = None
 ndlib_ctypes.overwriteDense16.restype = None
 ndlib_ctypes.overwriteDense64.restype = None
+ndlib_ctypes.overwriteDenseL.restype = None
+ndlib_ctypes.overwriteDense8L.restype = None
+ndlib_ctypes.overwriteDense16L.restype = None
+ndlib_ctypes.overwriteDense64L.restype = None
+ndlib_ctypes.overwriteDense4D.restype = None
+ndlib_ctypes.overwriteDense4D8.restype = None
+ndlib_ctypes.overwriteDense4D16.restype = None
+ndlib_ctypes.overwriteDense4D64.restype = None
+ndlib_ctypes.applyDenseOps.restype = None
+ndlib_ctypes.applyDenseOps8.restype = None
+ndlib_ctypes.applyDenseOps16.restype = None
+ndlib_ctypes.applyDenseOps64.restype = None
+ndlib_ctypes.overwriteDenseDirty.restype = cp.c_int
+ndlib_ctypes.overwriteDenseDirty8.restype = cp.c_int
+ndlib_ctypes.overwriteDenseDirty16.restype = cp.c_int
+ndlib_ctypes.overwriteDenseDirty64.restype = cp.c_int
 ndlib_ctypes.zoomOutData.restype = None
 ndlib_ctypes.zoomOutDataOMP.restype = None
 ndlib_ctypes.zoomInData.restype = None
+ndlib_ctypes.buildResolutionPyramid8.restype = None
+ndlib_ctypes.buildResolutionPyramid16.restype = None
+ndlib_ctypes.buildResolutionPyramid32.restype = None
+ndlib_ctypes.buildResolutionPyramid64.restype = None
 ndlib_ctypes.zoomInDataOMP16.restype = None
 ndlib_ctypes.zoomInDataOMP32.restype = None
+ndlib_ctypes.zoomOutDataOMPL.restype = None
+ndlib_ctypes.zoomInDataOMPL.restype = None
 ndlib_ctypes.mergeCube.restype = None
+ndlib_ctypes.mergeCube8.restype = None
+ndlib_ctypes.mergeCube16.restype = None
+ndlib_ctypes.mergeCube64.restype = None
+ndlib_ctypes.mergeCubeBatch.restype = None
+ndlib_ctypes.mergeCubeBatch8.restype = None
+ndlib_ctypes.mergeCubeBatch16.restype = None
+ndlib_ctypes.mergeCubeBatch64.restype = None
 ndlib_ctypes.isotropicBuild8.restype = None
 ndlib_ctypes.isotropicBuild16.restype = None
 ndlib_ctypes.isotropicBuild32.restype = None
 ndlib_ctypes.isotropicBuildF32.restype = None
 ndlib_ctypes.addDataZSlice.restype = None
 ndlib_ctypes.addDataIsotropic.restype = None
+ndlib_ctypes.addDataZSliceOMP.restype = None
+ndlib_ctypes.addDataZSliceOMP64.restype = None
+ndlib_ctypes.addDataIsotropicOMP.restype = None
+ndlib_ctypes.addDataIsotropicOMP64.restype = None
+ndlib_ctypes.addDataZSliceOMPL.restype = None
+ndlib_ctypes.addDataZSliceOMPL64.restype = None
+ndlib_ctypes.addDataIsotropicOMPL.restype = None
+ndlib_ctypes.addDataIsotropicOMPL64.restype = None
 ndlib_ctypes.addAnnotationData.restype = None
+ndlib_ctypes.addAnnotationDataOMP.restype = None
 ndlib_ctypes.unique.restype = cp.c_int
+ndlib_ctypes.uniqueOMP.restype = cp.c_int
+ndlib_ctypes.uniqueOMPL.restype = cp.c_int
+ndlib_ctypes.unique4D.restype = cp.c_int
+ndlib_ctypes.idHistogramOMP.restype = cp.c_int
+ndlib_ctypes.uniqueBBoxOMP.restype = cp.c_int
+ndlib_ctypes.idsInRegionOMP.restype = cp.c_int
+ndlib_ctypes.assembleCutout.restype = None
+ndlib_ctypes.sliceCutout.restype = None
+ndlib_ctypes.ndlibArenaCreate.restype = cp.c_void_p
+ndlib_ctypes.ndlibArenaAcquire.restype = cp.c_void_p
+ndlib_ctypes.ndlibArenaRelease.restype = None
+ndlib_ctypes.ndlibArenaDestroy.restype = None
+ndlib_ctypes.ndlibInit.restype = None
+ndlib_ctypes.ndlibSetThreads.restype = None
+ndlib_ctypes.ndlibGetThreads.restype = cp.c_int
+ndlib_ctypes.ndlibCpuFeatures.restype = cp.c_int
+ndlib_ctypes.ndlibCpuSetFeatures.restype = None
+ndlib_ctypes.ndlibStatsEnabled.restype = cp.c_int
+ndlib_ctypes.ndlibStatsSnapshot.restype = None
+ndlib_ctypes.ndlibStatsReset.restype = None
+ndlib_ctypes.bloscAvailable.restype = cp.c_int
+ndlib_ctypes.compressCuboid.restype = cp.c_int64
+ndlib_ctypes.decompressCuboid.restype = cp.c_int64
+ndlib_ctypes.rleEncode8.restype = cp.c_int64
+ndlib_ctypes.rleEncode16.restype = cp.c_int64
+ndlib_ctypes.rleEncode32.restype = cp.c_int64
+ndlib_ctypes.rleEncode64.restype = cp.c_int64
+ndlib_ctypes.rleDecode8.restype = None
+ndlib_ctypes.rleDecode16.restype = None
+ndlib_ctypes.rleDecode32.restype = None
+ndlib_ctypes.rleDecode64.restype = None
+ndlib_ctypes.rleFilter.restype = cp.c_int64
+ndlib_ctypes.rleUnique.restype = cp.c_int64
+ndlib_ctypes.rleOverwrite.restype = cp.c_int64
+ndlib_ctypes.cutoutPipelineCreate.restype = cp.c_void_p
+ndlib_ctypes.cutoutPipelineSubmit.restype = cp.c_int
+ndlib_ctypes.cutoutPipelineDrain.restype = cp.c_int
+ndlib_ctypes.cutoutPipelineDestroy.restype = None
+ndlib_ctypes.decompressCutout.restype = cp.c_int
+
+
+# Filter lists larger than this many bytes spill out of L1 and go through
+# the cache-blocked engine instead of the SIMD bitset/search engine
+L1_CACHE_BYTES = 32768
+
+# Arrays at or past this many voxels overflow the int sizes the legacy
+# kernels take and route through the 64-bit L-suffixed variants instead
+INT32_MAX_VOXELS = 2 ** 31
+
+
+def _filter_bitmap(unique_ids):
+    """Build the little-endian membership bitmap for the filterCutoutBitmap kernels"""
+
+    present = np.zeros(int(unique_ids[-1]) + 1, dtype=np.uint8)
+    present[unique_ids] = 1
+    return np.packbits(present, bitorder='little')
 
 
 def filter_ctype_OMP(cutout, filterlist):
-    """Remove all annotations in a cutout that do not match the filterlist using OpenMP"""
+    """Remove all annotations in a cutout that do not match the filterlist using OpenMP
+
+    Picks the cheapest predicate for the shape of the filter: one compare
+    pair per voxel when the ids form a single contiguous range (the usual
+    reserve_ids block), a bit test against a membership bitmap when the
+    sorted list would spill out of L1 but the id universe is dense, and
+    the list-scan kernels otherwise.
+    """
 
     cutout_shape = cutout.shape
     # Temp Fix
@@ -135,24 +474,92 @@ def filter_ctype_OMP(cutout, filterlist):
         cutout = np.asarray(cutout, dtype=np.uint32)
         cutout = cutout.ravel()
         filterlist = np.asarray(filterlist, dtype=np.uint32)
+        unique_ids = np.unique(filterlist)
         # Calling the C openmp funtion
-        ndlib_ctypes.filterCutoutOMP32(cutout, cp.c_int(len(cutout)),
-                                       np.sort(filterlist),
-                                       cp.c_int(len(filterlist)))
+        if len(cutout) >= INT32_MAX_VOXELS:
+            ndlib_ctypes.filterCutoutOMP32L(cutout, cp.c_int64(len(cutout)),
+                                            unique_ids, cp.c_int(len(unique_ids)))
+        elif len(unique_ids) > 0 and int(unique_ids[-1]) - int(unique_ids[0]) + 1 == len(unique_ids):
+            ndlib_ctypes.filterCutoutRange32(cutout, cp.c_int(len(cutout)),
+                                             cp.c_uint32(unique_ids[0]),
+                                             cp.c_uint32(unique_ids[-1]))
+        elif filterlist.nbytes > L1_CACHE_BYTES:
+            if int(unique_ids[-1]) // 8 + 1 <= L1_CACHE_BYTES:
+                ndlib_ctypes.filterCutoutBitmap32(cutout, cp.c_int(len(cutout)),
+                                                  _filter_bitmap(unique_ids),
+                                                  cp.c_uint32(unique_ids[-1]))
+            else:
+                ndlib_ctypes.filterCutoutOMPCache(cutout, cp.c_int(len(cutout)),
+                                                  np.sort(filterlist),
+                                                  cp.c_int(len(filterlist)))
+        else:
+            ndlib_ctypes.filterCutoutSIMD32(cutout, cp.c_int(len(cutout)),
+                                            np.sort(filterlist),
+                                            cp.c_int(len(filterlist)))
     elif cutout.dtype == np.uint64:
         # get a copy of the iterator as a 1-D array
         cutout = np.asarray(cutout, dtype=np.uint64)
         cutout = cutout.ravel()
         filterlist = np.asarray(filterlist, dtype=np.uint64)
+        unique_ids = np.unique(filterlist)
         # Calling the C openmp funtion
-        ndlib_ctypes.filterCutoutOMP64(cutout, cp.c_int(len(cutout)),
-                                       np.sort(filterlist),
-                                       cp.c_int(len(filterlist)))
+        if len(cutout) >= INT32_MAX_VOXELS:
+            ndlib_ctypes.filterCutoutOMP64L(cutout, cp.c_int64(len(cutout)),
+                                            unique_ids, cp.c_int(len(unique_ids)))
+        elif len(unique_ids) > 0 and int(unique_ids[-1]) - int(unique_ids[0]) + 1 == len(unique_ids):
+            ndlib_ctypes.filterCutoutRange64(cutout, cp.c_int(len(cutout)),
+                                             cp.c_uint64(unique_ids[0]),
+                                             cp.c_uint64(unique_ids[-1]))
+        elif filterlist.nbytes > L1_CACHE_BYTES:
+            if int(unique_ids[-1]) // 8 + 1 <= L1_CACHE_BYTES:
+                ndlib_ctypes.filterCutoutBitmap64(cutout, cp.c_int(len(cutout)),
+                                                  _filter_bitmap(unique_ids),
+                                                  cp.c_uint64(unique_ids[-1]))
+            else:
+                ndlib_ctypes.filterCutoutOMPCache64(cutout, cp.c_int(len(cutout)),
+                                                    np.sort(filterlist),
+                                                    cp.c_int(len(filterlist)))
+        else:
+            ndlib_ctypes.filterCutoutSIMD64(cutout, cp.c_int(len(cutout)),
+                                            np.sort(filterlist),
+                                            cp.c_int(len(filterlist)))
     else:
         raise ValueError('cutout must be uint32 or uint64 data type')
     return cutout.reshape(cutout_shape)
 
 
+def filter_ctype_OMP4D(cutout, filterlist):
+    """Remove all annotations in a 4D time-series cutout that do not match the filterlist.
+
+    One call covers every time sample of a (t, z, y, x) array, parallel over
+    t*z slabs, instead of one ctypes crossing and OMP region spin-up per
+    sample.
+
+    Args:
+        cutout (numpy.Array): C-contiguous 4D array in (t, z, y, x) order,
+        filtered in place.
+        filterlist (numpy.Array): The annotation ids to keep.
+
+    Returns:
+        (numpy.Array): cutout
+    """
+
+    time_samples = cutout.shape[0]
+    sample_size = cutout.shape[1] * cutout.shape[2] * cutout.shape[3]
+    dims = (cp.c_int * 3)(*cutout.shape[1:])
+    if cutout.dtype == np.uint32:
+        filterlist = np.unique(np.asarray(filterlist, dtype=np.uint32))
+        ndlib_ctypes.filterCutoutOMP4D32(cutout, cp.c_int(time_samples), cp.c_int64(sample_size),
+                                         dims, filterlist, cp.c_int(len(filterlist)))
+    elif cutout.dtype == np.uint64:
+        filterlist = np.unique(np.asarray(filterlist, dtype=np.uint64))
+        ndlib_ctypes.filterCutoutOMP4D64(cutout, cp.c_int(time_samples), cp.c_int64(sample_size),
+                                         dims, filterlist, cp.c_int(len(filterlist)))
+    else:
+        raise ValueError('cutout must be uint32 or uint64 data type')
+    return cutout
+
+
 def filter_ctype(cutout, filterlist):
     """Remove all annotations in a cutout that do not match the filterlist"""
 
@@ -165,19 +572,41 @@ def filter_ctype(cutout, filterlist):
     return flatcutout.reshape(cutout.shape[0], cutout.shape[1], cutout.shape[2])
 
 
-def annotate_ctype(data, annid, offset, locations, conflictopt):
-    """ Remove all annotations in a cutout that do not match the filterlist """
+def annotate_ctype(data, annid, offset, locations, conflictopt, exceptions_out=None):
+    """ Remove all annotations in a cutout that do not match the filterlist
+
+    exceptions_out may hold a reusable (len(locations), 3) uint32 scratch array
+    (e.g. from an NdlibArena) to avoid the per-call allocation.
+    """
 
     # get a copy of the iterator as a 1-D array
     datashape = data.shape
     dims = [i for i in data.shape]
     data = data.ravel()
 
-    exceptions = np.zeros((len(locations), 3), dtype=np.uint32)
+    if exceptions_out is not None and exceptions_out.shape[0] >= len(locations):
+        exceptions = exceptions_out
+    else:
+        exceptions = np.zeros((len(locations), 3), dtype=np.uint32)
+
+    # Calling the C native function for the data type
+    if data.dtype == np.uint32:
+        annotate_func = ndlib_ctypes.annotateCube
+        annid = cp.c_int(annid)
+    elif data.dtype == np.uint8:
+        annotate_func = ndlib_ctypes.annotateCube8
+        annid = cp.c_uint8(annid)
+    elif data.dtype == np.uint16:
+        annotate_func = ndlib_ctypes.annotateCube16
+        annid = cp.c_uint16(annid)
+    elif data.dtype == np.uint64:
+        annotate_func = ndlib_ctypes.annotateCube64
+        annid = cp.c_uint64(annid)
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
 
-    # Calling the C native function
-    exceptionIndex = ndlib_ctypes.annotateCube(data, cp.c_int(len(data)), (cp.c_int * len(dims))(*dims), cp.c_int(annid),
-                                               offset, locations, cp.c_int(len(locations)), cp.c_char(conflictopt), exceptions)
+    exceptionIndex = annotate_func(data, cp.c_int(len(data)), (cp.c_int * len(dims))(*dims), annid,
+                                   offset, locations, cp.c_int(len(locations)), cp.c_char(conflictopt), exceptions)
 
     if exceptionIndex > 0:
         exceptions = exceptions[:(exceptionIndex + 1)]
@@ -187,11 +616,69 @@ def annotate_ctype(data, annid, offset, locations, conflictopt):
     return (data.reshape(datashape), exceptions)
 
 
-def locate_ctype(locations, dims):
+def annotate_batch_ctype(data, annids, offset, locations_list, conflictopt):
+    """ Annotate many (id, locations) groups against one cutout in a single call
+
+    Replaces one annotate_ctype round trip per object with a single native
+    call that runs the groups in parallel. Conflict handling matches
+    annotate_ctype ('O' overwrite, 'P' preserve, 'E' exception).
+
+    Args:
+        data (numpy.Array): the cutout, annotated in place.
+        annids (list): one annotation id per group.
+        offset (numpy.Array): uint32[3] offset of the cutout.
+        locations_list (list): one uint32[n][3] location array per group.
+        conflictopt (str): conflict option byte, as in annotate_ctype.
+
+    Returns:
+        (numpy.Array, list): the data and one exceptions array per group.
+    """
+
+    # get a copy of the iterator as a 1-D array
+    datashape = data.shape
+    dims = [i for i in data.shape]
+    data = data.ravel()
+
+    num_groups = len(locations_list)
+    group_offsets = [0]
+    for locs in locations_list:
+        group_offsets.append(group_offsets[-1] + len(locs))
+    locations = np.ascontiguousarray(np.concatenate(locations_list), dtype=np.uint32)
+    exceptions = np.zeros((len(locations), 3), dtype=np.uint32)
+    exception_counts = (cp.c_int * num_groups)()
+
+    # Calling the C native function for the data type
+    if data.dtype == np.uint32:
+        batch_func = ndlib_ctypes.annotateCubeBatch
+    elif data.dtype == np.uint8:
+        batch_func = ndlib_ctypes.annotateCubeBatch8
+    elif data.dtype == np.uint16:
+        batch_func = ndlib_ctypes.annotateCubeBatch16
+    elif data.dtype == np.uint64:
+        batch_func = ndlib_ctypes.annotateCubeBatch64
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+
+    annid_arr = np.ascontiguousarray(annids, dtype=data.dtype)
+
+    batch_func(data, cp.c_int(len(data)), (cp.c_int * len(dims))(*dims), annid_arr, offset,
+               locations, (cp.c_int * (num_groups + 1))(*group_offsets), cp.c_int(num_groups),
+               cp.c_char(conflictopt), exceptions, exception_counts)
+
+    exceptions_list = []
+    for group in range(num_groups):
+        start = group_offsets[group]
+        exceptions_list.append(np.copy(exceptions[start:start + exception_counts[group]]))
+
+    return (data.reshape(datashape), exceptions_list)
+
+
+def locate_ctype(locations, dims, out=None):
     """ Find the morton ID of all locations passed in.
 
     Args:
         locations (numpy.Array): Array is uint32[][3].
+        out (numpy.Array): Optional reusable [n, 4] uint64 scratch array.
 
     Returns:
         (numpy.Array): an array with elements consisting of [mortonid, x, y, z].
@@ -199,7 +686,11 @@ def locate_ctype(locations, dims):
     """
 
     # get a copy of the iterator as a 1-D array
-    cubeLocs = np.zeros([len(locations), 4], dtype=np.uint64)
+    if out is not None and out.shape[0] >= len(locations):
+        cubeLocs = out[:len(locations)]
+        cubeLocs.fill(0)
+    else:
+        cubeLocs = np.zeros([len(locations), 4], dtype=np.uint64)
 
     # Calling the C native function
     ndlib_ctypes.locateCube(cubeLocs, cp.c_int(len(cubeLocs)), locations, cp.c_int(len(locations)),
@@ -208,6 +699,35 @@ def locate_ctype(locations, dims):
     return cubeLocs
 
 
+def locate_and_sort_ctype(locations, dims, out=None):
+    """ Find the morton ID of all locations passed in and sort the result on it.
+
+    Combines locate_ctype and quicksort into one c-lib call: morton keys
+    are computed and the rows are radix sorted in a single pass over the
+    data, with the same ordering quicksort produces.
+
+    Args:
+        locations (numpy.Array): Array is uint32[][3].
+
+    Returns:
+        (numpy.Array): a sorted array with elements consisting of [mortonid, x, y, z].
+
+    """
+
+    # get a copy of the iterator as a 1-D array
+    if out is not None and out.shape[0] >= len(locations):
+        cubeLocs = out[:len(locations)]
+        cubeLocs.fill(0)
+    else:
+        cubeLocs = np.zeros([len(locations), 4], dtype=np.uint64)
+
+    # Calling the C native function
+    ndlib_ctypes.locateAndSortCube(cubeLocs, cp.c_int(len(cubeLocs)), locations, cp.c_int(len(locations)),
+                                   (cp.c_int * len(dims))(*dims))
+
+    return cubeLocs
+
+
 def XYZMorton(xyz):
     """ Get morton order from XYZ coordinates
 
@@ -244,6 +764,659 @@ def MortonXYZ(morton):
     return [i for i in cubeoff]
 
 
+def XYZMortonBatch(xyz):
+    """ Get morton order for an array of XYZ coordinates in one call
+
+    Args:
+        xyz (numpy.Array): uint64[][3] array of cuboid x, y, z indexes.
+
+    Returns:
+        (numpy.Array): uint64 array of Morton ids, one per input row.
+    """
+
+    xyz = np.ascontiguousarray(xyz, dtype=np.uint64)
+    morton = np.zeros((len(xyz),), dtype=np.uint64)
+
+    # Calling the C native function
+    ndlib_ctypes.XYZMortonBatch(xyz, cp.c_int(len(xyz)), morton)
+
+    return morton
+
+
+def MortonXYZBatch(morton):
+    """ Get XYZ indices for an array of Morton ids in one call
+
+    Args:
+        morton (numpy.Array): uint64 array of Morton ids.
+
+    Returns:
+        (numpy.Array): uint64[][3] array of cuboid x, y, z indexes.
+    """
+
+    morton = np.ascontiguousarray(morton, dtype=np.uint64)
+    xyz = np.zeros((len(morton), 3), dtype=np.uint64)
+
+    # Calling the C native function
+    ndlib_ctypes.MortonXYZBatch(morton, cp.c_int(len(morton)), xyz)
+
+    return xyz
+
+
+def to_morton_layout(data):
+    """Relayout a row-major (z, y, x) cube into the compact Z-curve order.
+
+    Every 2x2x2 neighborhood of the result is 8 contiguous elements. For equal
+    extents the element order matches XYZMorton; for anisotropic cubes the
+    compact interleave keeps the index space dense.
+
+    Args:
+        data (numpy.Array): 3D array in (z, y, x) C order with power-of-two extents.
+
+    Returns:
+        (numpy.Array): Array of the same shape holding the Z-curve ordered elements.
+
+    """
+
+    for dim in data.shape:
+        if dim & (dim - 1):
+            raise ValueError('cube extents must be powers of two')
+
+    data = np.ascontiguousarray(data)
+    morton_data = np.empty_like(data)
+    dims = (cp.c_int * 3)(data.shape[0], data.shape[1], data.shape[2])
+
+    result = ndlib_ctypes.toMortonLayout(data.ctypes.data_as(cp.c_void_p),
+                                         morton_data.ctypes.data_as(cp.c_void_p),
+                                         dims, cp.c_int(data.itemsize))
+    if result < 0:
+        raise MemoryError('toMortonLayout failed')
+
+    return morton_data
+
+
+def from_morton_layout(data):
+    """Relayout a compact Z-curve ordered cube back into row-major (z, y, x) order.
+
+    Inverse of to_morton_layout.
+
+    Args:
+        data (numpy.Array): 3D array holding Z-curve ordered elements, shaped
+        (z, y, x) with power-of-two extents.
+
+    Returns:
+        (numpy.Array): Row-major array of the same shape.
+
+    """
+
+    for dim in data.shape:
+        if dim & (dim - 1):
+            raise ValueError('cube extents must be powers of two')
+
+    data = np.ascontiguousarray(data)
+    row_data = np.empty_like(data)
+    dims = (cp.c_int * 3)(data.shape[0], data.shape[1], data.shape[2])
+
+    result = ndlib_ctypes.fromMortonLayout(data.ctypes.data_as(cp.c_void_p),
+                                           row_data.ctypes.data_as(cp.c_void_p),
+                                           dims, cp.c_int(data.itemsize))
+    if result < 0:
+        raise MemoryError('fromMortonLayout failed')
+
+    return row_data
+
+
+def downsample_morton_vote(data, z_factor=2):
+    """Downsample a Z-curve ordered uint64 annotation cube with the addAnnotationData vote.
+
+    Each source block of z_factor*2*2 voxels is contiguous in the Z-curve
+    layout, so the vote is a straight sequential pass.
+
+    Args:
+        data (numpy.Array): Flat uint64 array holding a Z-curve ordered cube.
+        z_factor (int): 2 for a 2x2x2 reduction, 1 to keep z (1x2x2).
+
+    Returns:
+        (numpy.Array): Flat uint64 array of per-block votes, in source block order.
+
+    """
+
+    if data.dtype != np.uint64:
+        raise ValueError('data must be uint64 data type')
+
+    data = np.ascontiguousarray(data).ravel()
+    block_size = 8 if z_factor == 2 else 4
+    output = np.zeros(len(data) // block_size, dtype=np.uint64)
+
+    ndlib_ctypes.downsampleMortonVote64(data, output, cp.c_int64(len(output)), cp.c_int(z_factor))
+    return output
+
+
+def assembleCutout_ctype(region, cuboids, mortons, low_xyz):
+    """ Scatter a batch of decompressed cuboids into a cutout region in one call
+
+    All cuboids must have the same shape and dtype as the region and contain
+    all of the region's time samples. Each cuboid's position is derived from
+    its Morton id, relative to low_xyz.
+
+    Args:
+        region (numpy.Array): 4D (t, z, y, x) C-ordered destination array, modified in place.
+        cuboids (list(numpy.Array)): 4D C-ordered cuboid arrays to scatter.
+        mortons (list(int)): Morton id of each cuboid, in cuboids order.
+        low_xyz (list(int)): [x, y, z] cuboid grid index of the region's first cuboid.
+
+    Returns:
+        (numpy.Array): The region array.
+    """
+
+    mortons = np.ascontiguousarray(mortons, dtype=np.uint64)
+    low_xyz = np.ascontiguousarray(low_xyz, dtype=np.uint64)
+    cube_dims = [cuboids[0].shape[3], cuboids[0].shape[2], cuboids[0].shape[1]]
+    region_dims = [region.shape[3], region.shape[2], region.shape[1]]
+    cuboid_ptrs = (cp.c_void_p * len(cuboids))(*[c.ctypes.data_as(cp.c_void_p) for c in cuboids])
+
+    # Calling the C native function
+    ndlib_ctypes.assembleCutout(region.ctypes.data_as(cp.c_void_p), cuboid_ptrs, mortons,
+                                cp.c_int(len(cuboids)),
+                                (cp.c_int * len(cube_dims))(*cube_dims),
+                                (cp.c_int * len(region_dims))(*region_dims),
+                                low_xyz, cp.c_int(region.shape[0]),
+                                cp.c_int(region.dtype.itemsize))
+
+    return region
+
+
+def sliceCutout_ctype(region, mortons, low_xyz, cube_dim):
+    """ Gather per-cuboid arrays out of a write region in one call (mirror of assembleCutout)
+
+    Args:
+        region (numpy.Array): 4D (t, z, y, x) C-ordered source array covering the cuboid grid.
+        mortons (list(int)): Morton id of each cuboid to extract.
+        low_xyz (list(int)): [x, y, z] cuboid grid index of the region's first cuboid.
+        cube_dim (list(int)): Cuboid dimensions in [x, y, z].
+
+    Returns:
+        (list(numpy.Array)): 4D C-ordered cuboid arrays, one per Morton id, in mortons order.
+    """
+
+    mortons = np.ascontiguousarray(mortons, dtype=np.uint64)
+    low_xyz = np.ascontiguousarray(low_xyz, dtype=np.uint64)
+    region_dims = [region.shape[3], region.shape[2], region.shape[1]]
+    cuboids = [np.zeros((region.shape[0], cube_dim[2], cube_dim[1], cube_dim[0]), dtype=region.dtype)
+               for _ in range(len(mortons))]
+    cuboid_ptrs = (cp.c_void_p * len(cuboids))(*[c.ctypes.data_as(cp.c_void_p) for c in cuboids])
+
+    # Calling the C native function
+    ndlib_ctypes.sliceCutout(region.ctypes.data_as(cp.c_void_p), cuboid_ptrs, mortons,
+                             cp.c_int(len(cuboids)),
+                             (cp.c_int * len(cube_dim))(*cube_dim),
+                             (cp.c_int * len(region_dims))(*region_dims),
+                             low_xyz, cp.c_int(region.shape[0]),
+                             cp.c_int(region.dtype.itemsize))
+
+    return cuboids
+
+
+# Kernel family names, in NdlibStatSlot order (see ndlib.h)
+STAT_SLOT_NAMES = ['filter', 'morton', 'sort', 'unique', 'assemble', 'slice', 'decompress', 'overwrite']
+
+
+def stats_enabled():
+    """ Check if ndlib.so was built with the instrumentation counters
+
+    The counters are compiled in by building with STATS=-DNDLIB_STATS
+    (see makefile_LINUX); production builds leave them out.
+
+    Returns:
+        (bool): True when the counters are compiled in and advancing.
+    """
+
+    return bool(ndlib_ctypes.ndlibStatsEnabled())
+
+
+def stats_snapshot():
+    """ Snapshot the per-kernel-family instrumentation counters
+
+    Returns:
+        (dict): kernel family name -> (calls, voxels, nanoseconds). All zeros
+        when the library was built without -DNDLIB_STATS.
+    """
+
+    counters = np.zeros((len(STAT_SLOT_NAMES), 3), dtype=np.uint64)
+    ndlib_ctypes.ndlibStatsSnapshot(counters)
+    return {name: (int(counters[i][0]), int(counters[i][1]), int(counters[i][2]))
+            for i, name in enumerate(STAT_SLOT_NAMES)}
+
+
+def stats_reset():
+    """ Zero the instrumentation counters
+
+    Returns:
+        None
+    """
+
+    ndlib_ctypes.ndlibStatsReset()
+
+
+def ndlib_init(num_threads=0, affinity=False):
+    """ Apply the process-wide kernel thread settings once
+
+    Pins the OpenMP thread count every kernel sizes its parallel region
+    with (0 keeps the current count), disables dynamic adjustment so the
+    runtime keeps the pool alive between calls, warms the pool, and
+    optionally pins the pool threads to cores. Call once per worker
+    process so multi-worker deployments do not oversubscribe the host.
+
+    Args:
+        num_threads (int): Threads per kernel call; 0 keeps the current count.
+        affinity (bool): Pin pool threads to cores round-robin.
+
+    Returns:
+        None
+    """
+
+    ndlib_ctypes.ndlibInit(cp.c_int(num_threads), cp.c_int(1 if affinity else 0))
+
+
+def set_num_threads(num_threads):
+    """ Override the kernel thread count for subsequent calls """
+
+    ndlib_ctypes.ndlibSetThreads(cp.c_int(num_threads))
+
+
+def get_num_threads():
+    """ Current kernel thread count """
+
+    return ndlib_ctypes.ndlibGetThreads()
+
+
+# Feature-name to mask-bit mapping; must match the NDLIB_CPU_* defines
+# in ndlib.h
+_CPU_FEATURE_BITS = {'avx2': 0x1, 'avx512f': 0x2, 'bmi2': 0x4}
+
+
+def cpu_features():
+    """ CPU features the multi-versioned kernels dispatch on
+
+    ndlib.so is built without -march so one binary serves a mixed fleet;
+    the vector kernels carry baseline, AVX2 and AVX-512 bodies and pick
+    one at run time. This reports which paths are live on this host so a
+    deployment can verify what it is actually running.
+
+    Returns:
+        list(str): Active feature names (from 'avx2', 'avx512f', 'bmi2');
+        empty when the baseline paths are in use.
+    """
+
+    mask = ndlib_ctypes.ndlibCpuFeatures()
+    return [name for name, bit in sorted(_CPU_FEATURE_BITS.items()) if mask & bit]
+
+
+def set_cpu_features(features=None):
+    """ Restrict kernel dispatch to the given CPU features
+
+    Features the hardware lacks stay off regardless, so this can only
+    disable paths (for debugging or A/B timing), never enable them.
+
+    Args:
+        features (list(str)): Feature names to leave enabled, or None to
+        restore full hardware dispatch.
+
+    Returns:
+        None
+    """
+
+    if features is None:
+        mask = -1
+    else:
+        mask = 0
+        for name in features:
+            mask |= _CPU_FEATURE_BITS[name]
+
+    ndlib_ctypes.ndlibCpuSetFeatures(cp.c_int(mask))
+
+
+class kernel_threads:
+    """ Context manager temporarily overriding the kernel thread count
+
+    Usage:
+        with ndlib.kernel_threads(1):
+            ndlib.filter_ctype_OMP(cutout, ids)   # runs single-threaded
+    """
+
+    def __init__(self, num_threads):
+        self.num_threads = num_threads
+
+    def __enter__(self):
+        self.previous = get_num_threads()
+        set_num_threads(self.num_threads)
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        set_num_threads(self.previous)
+
+
+class NdlibArena:
+    """ Reusable scratch-buffer arena backing the out= variants of the wrappers.
+
+    A long-lived SpatialDB instance can create one arena and recycle the same
+    backing pages call after call: carve numpy views out with alloc(), pass
+    them as the out/exceptions_out buffers of the wrapper functions, and call
+    reset() once the results of a request have been consumed. reset()
+    invalidates every view handed out since the last reset, so results that
+    outlive the request must be copied first.
+    """
+
+    def __init__(self, capacity=64 * 1024 * 1024):
+        self._handle = ndlib_ctypes.ndlibArenaCreate(cp.c_uint64(capacity))
+        if not self._handle:
+            raise MemoryError('could not allocate a {} byte ndlib arena'.format(capacity))
+        self.capacity = capacity
+
+    def alloc(self, shape, dtype, zero=True):
+        """Carve an array view out of the arena.
+
+        Args:
+            shape (tuple): Shape of the array to allocate.
+            dtype: Numpy datatype of the array.
+            zero (bool): Zero-fill the view, matching np.zeros.
+
+        Returns:
+            (numpy.Array): View into the arena, or None when the arena is
+            exhausted and the caller should fall back to a regular allocation.
+        """
+        dtype = np.dtype(dtype)
+        num_bytes = int(np.prod(shape)) * dtype.itemsize
+        address = ndlib_ctypes.ndlibArenaAcquire(self._handle, cp.c_uint64(num_bytes))
+        if not address:
+            return None
+
+        buffer = (cp.c_uint8 * num_bytes).from_address(address)
+        array = np.frombuffer(buffer, dtype=dtype).reshape(shape)
+        if zero:
+            array.fill(0)
+        return array
+
+    def reset(self):
+        """Recycle the arena, invalidating all views handed out so far."""
+        ndlib_ctypes.ndlibArenaRelease(self._handle)
+
+    def close(self):
+        """Free the arena's backing storage."""
+        if self._handle:
+            ndlib_ctypes.ndlibArenaDestroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+
+def blosc_available():
+    """ Check if the native blosc pipeline stage is usable
+
+    The blosc shared library is loaded at runtime on first use; when it is
+    not installed all native blosc wrappers report failure and callers fall
+    back to python-blosc.
+
+    Returns:
+        (bool): True when the blosc C library was loaded.
+    """
+
+    return bool(ndlib_ctypes.bloscAvailable())
+
+
+def blosc_compress(data, typesize):
+    """ Compress a contiguous array with the native blosc stage
+
+    Args:
+        data (numpy.Array): C-contiguous array to compress.
+        typesize (int): blosc typesize, matching what python-blosc is called with.
+
+    Returns:
+        (bytes|None): The compressed frame, or None if the native stage is unavailable
+        or compression failed and the caller should fall back to python-blosc.
+    """
+
+    frame = np.empty((data.nbytes + 16,), dtype=np.uint8)
+    csize = ndlib_ctypes.compressCuboid(cp.c_void_p(data.ctypes.data), cp.c_uint64(data.nbytes),
+                                        cp.c_int(typesize), frame, cp.c_uint64(frame.nbytes))
+    if csize < 0:
+        return None
+    return frame[:csize].tobytes()
+
+
+def blosc_decompress_into(frame, dest):
+    """ Decompress a blosc frame directly into a caller-provided array
+
+    Avoids the intermediate bytes object and copy of the python-blosc path by
+    writing decompressed voxels straight into dest, which may be a contiguous
+    view into a larger array (e.g. one time sample of a cube matrix).
+
+    Args:
+        frame (bytes): The compressed blosc frame.
+        dest (numpy.Array): C-contiguous array the frame decompresses into exactly.
+
+    Returns:
+        (bool): True on success. On False the caller should fall back to python-blosc.
+    """
+
+    dsize = ndlib_ctypes.decompressCuboid(cp.c_char_p(frame), cp.c_void_p(dest.ctypes.data),
+                                          cp.c_uint64(dest.nbytes))
+    return dsize == dest.nbytes
+
+
+def _rle_dispatch(dtype, funcs):
+    """Pick the per-width rle encoder/decoder for dtype from a funcs 4-tuple"""
+
+    if dtype == np.uint8:
+        return funcs[0]
+    elif dtype == np.uint16:
+        return funcs[1]
+    elif dtype == np.uint32:
+        return funcs[2]
+    elif dtype == np.uint64:
+        return funcs[3]
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+
+
+def rle_encode(data, max_runs=None):
+    """ Run-length encode a cuboid into a (value, length) pair stream
+
+    Args:
+        data (numpy.Array): C-contiguous cuboid of any shape.
+        max_runs (int): Run budget; defaults to half the dense byte size so
+        an RLE frame is only produced when it actually shrinks the cuboid.
+
+    Returns:
+        (numpy.Array): 1-D uint64 stream of (value, length) pairs, or None
+        when the cuboid is not run-compressible within the budget and should
+        stay dense.
+    """
+
+    flat = data.ravel()
+    if max_runs is None:
+        max_runs = max(int(data.nbytes // 32), 16)
+    runs = np.zeros(2 * max_runs, dtype=np.uint64)
+
+    encode_func = _rle_dispatch(data.dtype, (ndlib_ctypes.rleEncode8, ndlib_ctypes.rleEncode16,
+                                             ndlib_ctypes.rleEncode32, ndlib_ctypes.rleEncode64))
+    num_runs = encode_func(flat, cp.c_int64(len(flat)), runs, cp.c_int64(max_runs))
+
+    if num_runs < 0:
+        return None
+    return runs[:2 * num_runs]
+
+
+def rle_decode(runs, datatype, shape):
+    """ Expand a (value, length) pair stream back into a dense cuboid
+
+    Args:
+        runs (numpy.Array): 1-D uint64 stream from rle_encode.
+        datatype (numpy.dtype): Voxel data type of the cuboid.
+        shape (tuple): Shape of the dense cuboid; must match the run lengths.
+
+    Returns:
+        (numpy.Array): The dense cuboid.
+    """
+
+    out = np.empty(shape, dtype=datatype)
+    decode_func = _rle_dispatch(out.dtype, (ndlib_ctypes.rleDecode8, ndlib_ctypes.rleDecode16,
+                                            ndlib_ctypes.rleDecode32, ndlib_ctypes.rleDecode64))
+    decode_func(np.ascontiguousarray(runs, dtype=np.uint64), cp.c_int64(len(runs) // 2), out.ravel())
+    return out
+
+
+def rle_filter(runs, filterlist):
+    """ Zero every run whose id is not in filterlist, without decoding
+
+    Returns the (possibly shorter) coalesced run stream. Cost is
+    O(runs log ids) instead of a pass over every voxel.
+    """
+
+    runs = np.ascontiguousarray(runs, dtype=np.uint64).copy()
+    filterlist = np.sort(np.asarray(filterlist, dtype=np.uint64))
+    num_runs = ndlib_ctypes.rleFilter(runs, cp.c_int64(len(runs) // 2),
+                                      filterlist, cp.c_int(len(filterlist)))
+    return runs[:2 * num_runs]
+
+
+def rle_unique(runs, max_ids=1048576):
+    """ Distinct nonzero ids of an RLE cuboid in ascending order, without decoding """
+
+    runs = np.ascontiguousarray(runs, dtype=np.uint64)
+    ids = np.zeros(max_ids, dtype=np.uint64)
+    num_ids = ndlib_ctypes.rleUnique(runs, cp.c_int64(len(runs) // 2), ids, cp.c_int(max_ids))
+    if num_ids < 0:
+        return None
+    return ids[:num_ids]
+
+
+def rle_overwrite(dst_runs, src_runs):
+    """ Overwrite dst with the nonzero voxels of src at the run level
+
+    The run form of overwriteDense_ctype: both streams must describe the
+    same voxel count. Returns the merged run stream, or None when the
+    result would not fit the output budget.
+    """
+
+    dst_runs = np.ascontiguousarray(dst_runs, dtype=np.uint64)
+    src_runs = np.ascontiguousarray(src_runs, dtype=np.uint64)
+    max_runs = len(dst_runs) // 2 + len(src_runs) // 2 + 1
+    out = np.zeros(2 * max_runs, dtype=np.uint64)
+    num_runs = ndlib_ctypes.rleOverwrite(dst_runs, cp.c_int64(len(dst_runs) // 2),
+                                         src_runs, cp.c_int64(len(src_runs) // 2),
+                                         out, cp.c_int64(max_runs))
+    if num_runs < 0:
+        return None
+    return out[:2 * num_runs]
+
+
+def decompressCutout_ctype(region, frames, mortons, low_xyz, cube_dim):
+    """ Decompress blosc frames and scatter them into a cutout region in one call
+
+    The fused form of blosc_decompress_into + assembleCutout_ctype for callers
+    holding raw compressed frames: each frame is decompressed and scattered to
+    its final region offset from OpenMP threads, overlapping decompression
+    with assembly.
+
+    Args:
+        region (numpy.Array): 4D (t, z, y, x) C-ordered destination array, modified in place.
+        frames (list(bytes)): Compressed blosc frames, one full cuboid (all time samples) each.
+        mortons (list(int)): Morton id of each frame's cuboid, in frames order.
+        low_xyz (list(int)): [x, y, z] cuboid grid index of the region's first cuboid.
+        cube_dim (list(int)): Cuboid dimensions in [x, y, z].
+
+    Returns:
+        (bool): True when every frame decompressed and scattered. On False the
+        caller should fall back to the unfused path.
+    """
+
+    mortons = np.ascontiguousarray(mortons, dtype=np.uint64)
+    low_xyz = np.ascontiguousarray(low_xyz, dtype=np.uint64)
+    region_dims = [region.shape[3], region.shape[2], region.shape[1]]
+    frame_ptrs = (cp.c_char_p * len(frames))(*frames)
+
+    # Calling the C native function
+    failed = ndlib_ctypes.decompressCutout(cp.c_void_p(region.ctypes.data), frame_ptrs, mortons,
+                                           cp.c_int(len(frames)),
+                                           (cp.c_int * len(cube_dim))(*cube_dim),
+                                           (cp.c_int * len(region_dims))(*region_dims),
+                                           low_xyz, cp.c_int(region.shape[0]),
+                                           cp.c_int(region.dtype.itemsize))
+
+    return failed == 0
+
+
+class CutoutPipeline:
+    """ Pipelined decompress-and-scatter stage for the cutout read path
+
+    The streaming form of decompressCutout_ctype: frames are submitted one
+    at a time as they arrive from the key-value store and native worker
+    threads overlap decompression of frame N+1 with the scatter of frame N
+    into the region, so network reads run concurrently with decompression.
+
+    Usage:
+        pipeline = CutoutPipeline(region, cube_dim, low_xyz)
+        if pipeline.active:
+            for frame, morton in fetched_frames:
+                pipeline.submit(frame, morton)
+            ok = pipeline.drain()
+
+    When blosc is unavailable the pipeline never starts (active is False)
+    and the caller should use the python-blosc fallback instead.
+    """
+
+    def __init__(self, region, cube_dim, low_xyz, workers=2):
+        """ Start a pipeline scattering into region
+
+        Args:
+            region (numpy.Array): 4D (t, z, y, x) C-ordered destination array.
+            cube_dim (list(int)): Cuboid dimensions in [x, y, z].
+            low_xyz (list(int)): [x, y, z] cuboid grid index of the region's first cuboid.
+            workers (int): Number of native worker threads.
+        """
+
+        # keep the region referenced while native threads write into it
+        self.region = region
+        low_xyz = np.ascontiguousarray(low_xyz, dtype=np.uint64)
+        region_dims = [region.shape[3], region.shape[2], region.shape[1]]
+        self.handle = ndlib_ctypes.cutoutPipelineCreate(cp.c_void_p(region.ctypes.data),
+                                                        (cp.c_int * len(cube_dim))(*cube_dim),
+                                                        (cp.c_int * len(region_dims))(*region_dims),
+                                                        low_xyz, cp.c_int(region.shape[0]),
+                                                        cp.c_int(region.dtype.itemsize),
+                                                        cp.c_int(workers))
+
+    @property
+    def active(self):
+        return self.handle is not None
+
+    def submit(self, frame, morton):
+        """ Queue one compressed frame; the bytes are copied so the caller's
+        buffer may be reused immediately. Blocks while the queue is full. """
+
+        ndlib_ctypes.cutoutPipelineSubmit(self.handle, cp.c_char_p(frame),
+                                          cp.c_uint64(len(frame)), cp.c_uint64(morton))
+
+    def drain(self):
+        """ Wait for every submitted frame to land in the region
+
+        Returns:
+            (bool): True when every frame decompressed and scattered. On False
+            the caller should redo the cutout through the unfused path.
+        """
+
+        failed = ndlib_ctypes.cutoutPipelineDrain(self.handle)
+        ndlib_ctypes.cutoutPipelineDestroy(self.handle)
+        self.handle = None
+        return failed == 0
+
+    def __del__(self):
+        if getattr(self, 'handle', None) is not None:
+            ndlib_ctypes.cutoutPipelineDestroy(self.handle)
+            self.handle = None
+
+
 def recolor_ctype(cutout, imagemap):
     """ Annotation recoloring function """
 
@@ -261,6 +1434,75 @@ def recolor_ctype(cutout, imagemap):
     return imagemap
 
 
+# Packed RGBA8 palette shared by the direct-to-RGBA recolor engine
+_rgba8_palette = np.asarray(rgbColor.rgbcolor, dtype=np.uint32)
+
+
+def recolor_rgba_ctype(cutout):
+    """False color a 2D annotation slice directly to packed RGBA8.
+
+    Replaces recolor_ctype plus the numpy narrowing pass: the C engine
+    emits the final uint32 RGBA8 pixels (AVX2 palette gather on the uint32
+    path), so no full-width imagemap is materialized.
+
+    Args:
+        cutout (numpy.Array): C-contiguous 2D uint32 or uint64 array.
+
+    Returns:
+        (numpy.Array): uint32 array of cutout's shape holding RGBA8 pixels.
+    """
+
+    if not cutout.flags['C_CONTIGUOUS']:
+        cutout = np.ascontiguousarray(cutout, dtype=cutout.dtype)
+    imagemap = np.zeros(cutout.shape, dtype=np.uint32)
+    if cutout.dtype == np.uint32:
+        ndlib_ctypes.recolorSliceRGBA32(cutout, cp.c_int(cutout.size), imagemap, _rgba8_palette)
+    elif cutout.dtype == np.uint64:
+        ndlib_ctypes.recolorSliceRGBA64(cutout, cp.c_int(cutout.size), imagemap, _rgba8_palette)
+    else:
+        raise ValueError('cutout must be uint32 or uint64 data type')
+    return imagemap
+
+
+def render_tile(data, plane, index):
+    """Render one false-colored RGBA8 tile from a cuboid in a single pass.
+
+    Fuses the plane cut and recolor: the C engine slices the xy, xz or yz
+    plane out of the cuboid and colors it through the palette in one OpenMP
+    pass, so no intermediate annotation slice or full-width imagemap is
+    materialized between the cuboid and the tile buffer.
+
+    Args:
+        data (numpy.Array): C-contiguous 3D uint32 or uint64 array in
+        (z, y, x) order.
+        plane (str): 'xy', 'xz' or 'yz'.
+        index (int): The fixed coordinate of the plane (z for xy, y for xz,
+        x for yz).
+
+    Returns:
+        (numpy.Array): uint32 array of RGBA8 pixels, shaped (y, x) for xy,
+        (z, x) for xz and (z, y) for yz.
+    """
+
+    planes = {'xy': 0, 'xz': 1, 'yz': 2}
+    if plane not in planes:
+        raise ValueError("plane must be 'xy', 'xz' or 'yz'")
+
+    zdim, ydim, xdim = data.shape
+    rows, cols = {'xy': (ydim, xdim), 'xz': (zdim, xdim), 'yz': (zdim, ydim)}[plane]
+    tile = np.zeros((rows, cols), dtype=np.uint32)
+    dims = (cp.c_int * 3)(zdim, ydim, xdim)
+    if data.dtype == np.uint32:
+        ndlib_ctypes.renderTile32(data, dims, cp.c_int(planes[plane]), cp.c_int(index),
+                                  tile, _rgba8_palette)
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.renderTile64(data, dims, cp.c_int(planes[plane]), cp.c_int(index),
+                                  tile, _rgba8_palette)
+    else:
+        raise ValueError('data must be uint32 or uint64 data type')
+    return tile
+
+
 def quicksort(locs):
     """ Sort the cube on Morton Id """
 
@@ -269,77 +1511,293 @@ def quicksort(locs):
     return locs
 
 
-def shave_ctype(data, annid, offset, locations):
-    """ Remove annotations by a list of locations """
+def shave_ctype(data, annid, offset, locations, exceptions_out=None, zeroed_out=None):
+    """ Remove annotations by a list of locations
+
+    Routed through the batched shave engine as a single group so the
+    exception/zeroed counts actually reach us; the legacy shaveCube entry
+    points take their count arguments by value and can never report them.
+
+    exceptions_out and zeroed_out may hold reusable (len(locations), 3) uint32
+    scratch arrays (e.g. from an NdlibArena) to avoid the per-call allocations.
+    """
 
     # get a copy of the iterator as a 1-D array
     datashape = data.shape
     dims = [i for i in data.shape]
     data = data.ravel()
 
-    exceptions = np.zeros((len(locations), 3), dtype=np.uint32)
-    zeroed = np.zeros((len(locations), 3), dtype=np.uint32)
+    if exceptions_out is not None and exceptions_out.shape[0] >= len(locations):
+        exceptions = exceptions_out
+    else:
+        exceptions = np.zeros((len(locations), 3), dtype=np.uint32)
+    if zeroed_out is not None and zeroed_out.shape[0] >= len(locations):
+        zeroed = zeroed_out
+    else:
+        zeroed = np.zeros((len(locations), 3), dtype=np.uint32)
+
+    # Calling the C native function for the data type
+    if data.dtype == np.uint32:
+        shave_func = ndlib_ctypes.shaveCubeBatch
+    elif data.dtype == np.uint8:
+        shave_func = ndlib_ctypes.shaveCubeBatch8
+    elif data.dtype == np.uint16:
+        shave_func = ndlib_ctypes.shaveCubeBatch16
+    elif data.dtype == np.uint64:
+        shave_func = ndlib_ctypes.shaveCubeBatch64
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
 
-    exceptionIndex = -1
-    zeroedIndex = -1
+    annid_arr = np.ascontiguousarray([annid], dtype=data.dtype)
+    exception_counts = (cp.c_int * 1)()
+    zeroed_counts = (cp.c_int * 1)()
 
-    # Calling the C native function
-    ndlib_ctypes.shaveCube(data, cp.c_int(len(data)), (cp.c_int * len(dims))(*dims), cp.c_int(annid), offset, locations,
-                           cp.c_int(len(locations)), exceptions, cp.c_int(exceptionIndex), zeroed, cp.c_int(zeroedIndex))
+    shave_func(data, cp.c_int(len(data)), (cp.c_int * len(dims))(*dims), annid_arr, offset, locations,
+               (cp.c_int * 2)(0, len(locations)), cp.c_int(1), exceptions, exception_counts,
+               zeroed, zeroed_counts)
 
-    if exceptionIndex > 0:
-        exceptions = exceptions[:(exceptionIndex + 1)]
+    if exception_counts[0] > 0:
+        exceptions = exceptions[:exception_counts[0]]
     else:
         exceptions = np.zeros((0), dtype=np.uint32)
 
-    if zeroedIndex > 0:
-        zeroed = zeroed[:(zeroedIndex + 1)]
+    if zeroed_counts[0] > 0:
+        zeroed = zeroed[:zeroed_counts[0]]
     else:
         zeroed = np.zeros((0), dtype=np.uint32)
 
     return (data.reshape(datashape), exceptions, zeroed)
 
 
+def shave_batch_ctype(data, annids, offset, locations_list):
+    """ Shave many (id, locations) groups out of one cutout in a single call
+
+    Args:
+        data (numpy.Array): the cutout, shaved in place.
+        annids (list): one annotation id per group.
+        offset (numpy.Array): uint32[3] offset of the cutout.
+        locations_list (list): one uint32[n][3] location array per group.
+
+    Returns:
+        (numpy.Array, list, list): the data plus one exceptions array and one
+        zeroed array per group.
+    """
+
+    # get a copy of the iterator as a 1-D array
+    datashape = data.shape
+    dims = [i for i in data.shape]
+    data = data.ravel()
+
+    num_groups = len(locations_list)
+    group_offsets = [0]
+    for locs in locations_list:
+        group_offsets.append(group_offsets[-1] + len(locs))
+    locations = np.ascontiguousarray(np.concatenate(locations_list), dtype=np.uint32)
+    exceptions = np.zeros((len(locations), 3), dtype=np.uint32)
+    zeroed = np.zeros((len(locations), 3), dtype=np.uint32)
+    exception_counts = (cp.c_int * num_groups)()
+    zeroed_counts = (cp.c_int * num_groups)()
+
+    # Calling the C native function for the data type
+    if data.dtype == np.uint32:
+        batch_func = ndlib_ctypes.shaveCubeBatch
+    elif data.dtype == np.uint8:
+        batch_func = ndlib_ctypes.shaveCubeBatch8
+    elif data.dtype == np.uint16:
+        batch_func = ndlib_ctypes.shaveCubeBatch16
+    elif data.dtype == np.uint64:
+        batch_func = ndlib_ctypes.shaveCubeBatch64
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+
+    annid_arr = np.ascontiguousarray(annids, dtype=data.dtype)
+
+    batch_func(data, cp.c_int(len(data)), (cp.c_int * len(dims))(*dims), annid_arr, offset,
+               locations, (cp.c_int * (num_groups + 1))(*group_offsets), cp.c_int(num_groups),
+               exceptions, exception_counts, zeroed, zeroed_counts)
+
+    exceptions_list = []
+    zeroed_list = []
+    for group in range(num_groups):
+        start = group_offsets[group]
+        exceptions_list.append(np.copy(exceptions[start:start + exception_counts[group]]))
+        zeroed_list.append(np.copy(zeroed[start:start + zeroed_counts[group]]))
+
+    return (data.reshape(datashape), exceptions_list, zeroed_list)
+
+
 def annotateEntityDense_ctype(data, entityid):
     """ Relabel all non zero pixels to annotation id """
 
     dims = [i for i in data.shape]
-    ndlib_ctypes.annotateEntityDense(data, (cp.c_int * len(dims))(*dims), cp.c_int(entityid))
+    if data.dtype == np.uint32:
+        ndlib_ctypes.annotateEntityDense(data, (cp.c_int * len(dims))(*dims), cp.c_int(entityid))
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.annotateEntityDense8(data, (cp.c_int * len(dims))(*dims), cp.c_uint8(entityid))
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.annotateEntityDense16(data, (cp.c_int * len(dims))(*dims), cp.c_uint16(entityid))
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.annotateEntityDense64(data, (cp.c_int * len(dims))(*dims), cp.c_uint64(entityid))
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
     return (data)
 
 
 def shaveDense_ctype(data, shavedata):
     """ Remove the specified voxels from the annotation """
 
+    if shavedata.dtype != data.dtype:
+        shavedata = shavedata.astype(data.dtype)
+    if not shavedata.flags['C_CONTIGUOUS']:
+        shavedata = np.ascontiguousarray(shavedata, dtype=data.dtype)
     dims = [i for i in data.shape]
-    ndlib_ctypes.shaveDense(data, shavedata, (cp.c_int * len(dims))(*dims))
+    if data.dtype == np.uint32:
+        ndlib_ctypes.shaveDense(data, shavedata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.shaveDense8(data, shavedata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.shaveDense16(data, shavedata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.shaveDense64(data, shavedata, (cp.c_int * len(dims))(*dims))
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
     return (data)
 
 
 def exceptionDense_ctype(data, annodata):
     """ Get a dense voxel region and overwrite all the non-zero values """
 
-    data = np.uint32(data)
-    annodata = np.uint32(annodata)
+    if annodata.dtype != data.dtype:
+        annodata = annodata.astype(data.dtype)
     if not annodata.flags['C_CONTIGUOUS']:
-        annodata = np.ascontiguousarray(annodata, np.uint32)
+        annodata = np.ascontiguousarray(annodata, dtype=data.dtype)
     dims = [i for i in data.shape]
-    ndlib_ctypes.exceptionDense(data, annodata, (cp.c_int * len(dims))(*dims))
+    if data.dtype == np.uint32:
+        ndlib_ctypes.exceptionDense(data, annodata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.exceptionDense8(data, annodata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.exceptionDense16(data, annodata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.exceptionDense64(data, annodata, (cp.c_int * len(dims))(*dims))
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
     return (data)
 
 
 def overwriteDense_ctype(data, annodata):
     """ Get a dense voxel region and overwrite all the non-zero values """
 
-    orginal_dtype = data.dtype
-    data = np.uint32(data)
-    annodata = np.uint32(annodata)
-    # data = np.ascontiguousarray(data,dtype=np.uint32)
+    if annodata.dtype != data.dtype:
+        annodata = annodata.astype(data.dtype)
     if not annodata.flags['C_CONTIGUOUS']:
-        annodata = np.ascontiguousarray(annodata, dtype=np.uint32)
+        annodata = np.ascontiguousarray(annodata, dtype=data.dtype)
     dims = [i for i in data.shape]
-    ndlib_ctypes.overwriteDense(data, annodata, (cp.c_int * len(dims))(*dims))
-    return (data.astype(orginal_dtype, copy=False))
+    if data.size >= INT32_MAX_VOXELS:
+        dims64 = (cp.c_int64 * len(dims))(*dims)
+        if data.dtype == np.uint32:
+            ndlib_ctypes.overwriteDenseL(data, annodata, dims64)
+        elif data.dtype == np.uint8:
+            ndlib_ctypes.overwriteDense8L(data, annodata, dims64)
+        elif data.dtype == np.uint16:
+            ndlib_ctypes.overwriteDense16L(data, annodata, dims64)
+        elif data.dtype == np.uint64:
+            ndlib_ctypes.overwriteDense64L(data, annodata, dims64)
+        else:
+            raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+    elif data.dtype == np.uint32:
+        ndlib_ctypes.overwriteDense(data, annodata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.overwriteDense8(data, annodata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.overwriteDense16(data, annodata, (cp.c_int * len(dims))(*dims))
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.overwriteDense64(data, annodata, (cp.c_int * len(dims))(*dims))
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+    return (data)
+
+
+def overwriteDense4D_ctype(data, annodata):
+    """Overwrite all the non-zero values of every time sample in one call.
+
+    The 4D form of overwriteDense_ctype for (t, z, y, x) arrays, parallel
+    over t*z slabs, instead of one ctypes crossing and OMP region spin-up
+    per sample.
+    """
+
+    if annodata.dtype != data.dtype:
+        annodata = annodata.astype(data.dtype)
+    if not annodata.flags['C_CONTIGUOUS']:
+        annodata = np.ascontiguousarray(annodata, dtype=data.dtype)
+    time_samples = data.shape[0]
+    sample_size = data.shape[1] * data.shape[2] * data.shape[3]
+    dims = (cp.c_int * 3)(*data.shape[1:])
+    if data.dtype == np.uint32:
+        ndlib_ctypes.overwriteDense4D(data, annodata, cp.c_int(time_samples),
+                                      cp.c_int64(sample_size), dims)
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.overwriteDense4D8(data, annodata, cp.c_int(time_samples),
+                                       cp.c_int64(sample_size), dims)
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.overwriteDense4D16(data, annodata, cp.c_int(time_samples),
+                                        cp.c_int64(sample_size), dims)
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.overwriteDense4D64(data, annodata, cp.c_int(time_samples),
+                                        cp.c_int64(sample_size), dims)
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+    return (data)
+
+
+def apply_dense_ops(data, ops):
+    """ Apply an ordered list of dense merge operations in one fused pass
+
+    The fused form of back-to-back overwriteDense_ctype /
+    exceptionDense_ctype / shaveDense_ctype calls: the cuboid and each
+    operand stream through memory exactly once no matter how many
+    operations are applied, with per-voxel semantics and ordering
+    identical to running the single-op wrappers sequentially.
+
+    Args:
+        data (numpy.Array): C-contiguous cuboid, modified in place.
+        ops (list): Ordered (op, operand) pairs where op is 'overwrite',
+        'exception' or 'shave' and operand matches data's shape.
+
+    Returns:
+        (numpy.Array): data
+    """
+
+    op_codes = {'overwrite': 0, 'exception': 1, 'shave': 2}
+
+    operands = []
+    for op, operand in ops:
+        if op not in op_codes:
+            raise ValueError("op must be 'overwrite', 'exception' or 'shave'")
+        if operand.dtype != data.dtype:
+            operand = operand.astype(data.dtype)
+        if not operand.flags['C_CONTIGUOUS']:
+            operand = np.ascontiguousarray(operand, dtype=data.dtype)
+        operands.append(operand)
+
+    if data.dtype == np.uint32:
+        fused_func = ndlib_ctypes.applyDenseOps
+    elif data.dtype == np.uint8:
+        fused_func = ndlib_ctypes.applyDenseOps8
+    elif data.dtype == np.uint16:
+        fused_func = ndlib_ctypes.applyDenseOps16
+    elif data.dtype == np.uint64:
+        fused_func = ndlib_ctypes.applyDenseOps64
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+
+    operand_ptrs = (cp.c_void_p * len(operands))(*[a.ctypes.data_as(cp.c_void_p).value for a in operands])
+    op_arr = (cp.c_int * len(ops))(*[op_codes[op] for op, _ in ops])
+
+    fused_func(cp.c_void_p(data.ctypes.data), operand_ptrs, op_arr,
+               cp.c_int(len(ops)), cp.c_int64(data.size))
+
+    return data
 
 
 def overwriteDense8_ctype(data, annodata):
@@ -376,6 +1834,39 @@ def overwriteDense64_ctype(data, annodata):
     return data.astype(orginal_dtype, copy=False)
 
 
+def overwriteDenseDirty_ctype(data, annodata):
+    """ Get a dense voxel region and overwrite all the non-zero values,
+    reporting which outermost (z) slices actually changed.
+
+    Args:
+        data (numpy.Array): 3D cuboid the merge is applied to, in place.
+        annodata (numpy.Array): 3D cuboid of new values to merge.
+
+    Returns:
+        (numpy.Array, numpy.Array, int): The merged data, a uint8 bitmap
+        with one entry per outermost slice (1 when the slice changed),
+        and the total number of changed voxels.
+    """
+
+    if annodata.dtype != data.dtype:
+        annodata = annodata.astype(data.dtype)
+    if not annodata.flags['C_CONTIGUOUS']:
+        annodata = np.ascontiguousarray(annodata, dtype=data.dtype)
+    dims = [i for i in data.shape]
+    dirty = np.zeros((data.shape[0],), dtype=np.uint8)
+    if data.dtype == np.uint32:
+        changed = ndlib_ctypes.overwriteDenseDirty(data, annodata, (cp.c_int * len(dims))(*dims), dirty)
+    elif data.dtype == np.uint8:
+        changed = ndlib_ctypes.overwriteDenseDirty8(data, annodata, (cp.c_int * len(dims))(*dims), dirty)
+    elif data.dtype == np.uint16:
+        changed = ndlib_ctypes.overwriteDenseDirty16(data, annodata, (cp.c_int * len(dims))(*dims), dirty)
+    elif data.dtype == np.uint64:
+        changed = ndlib_ctypes.overwriteDenseDirty64(data, annodata, (cp.c_int * len(dims))(*dims), dirty)
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+    return (data, dirty, changed)
+
+
 def zoomOutData_ctype(olddata, newdata, factor):
     """ Add the contribution of the input data to the next level at the given offset in the output cube """
 
@@ -396,10 +1887,50 @@ def zoomOutData_ctype_OMP(olddata, newdata, factor):
     """ Add the contribution of the input data to the next level at the given offset in the output cube """
 
     dims = [i for i in newdata.shape]
-    ndlib_ctypes.zoomOutDataOMP(olddata, newdata, (cp.c_int * len(dims))(*dims), cp.c_int(factor))
+    if olddata.size >= INT32_MAX_VOXELS:
+        ndlib_ctypes.zoomOutDataOMPL(olddata, newdata, (cp.c_int64 * len(dims))(*dims), cp.c_int(factor))
+    else:
+        ndlib_ctypes.zoomOutDataOMP(olddata, newdata, (cp.c_int * len(dims))(*dims), cp.c_int(factor))
     return (newdata)
 
 
+def buildResolutionPyramid_ctype(base, num_levels):
+    """ Emit every coarser resolution level of a base cuboid in one fused pass.
+
+    Each level k matches zoomOutData_ctype with factor k+1: point sampled, x and
+    y halved per level, z preserved. Replaces calling zoomOutData once per level,
+    which re-reads the base data every time.
+
+    Args:
+        base (numpy.Array): 3D array in (z, y, x) C order. The x and y extents
+        must stay divisible by two across num_levels halvings.
+        num_levels (int): Number of coarser levels to build.
+
+    Returns:
+        (list[numpy.Array]): The coarser levels, finest first.
+
+    """
+
+    zdim, ydim, xdim = base.shape
+    levels = [np.zeros((zdim, ydim >> (level + 1), xdim >> (level + 1)), dtype=base.dtype)
+              for level in range(num_levels)]
+    level_ptrs = (cp.c_void_p * num_levels)(*[l.ctypes.data_as(cp.c_void_p) for l in levels])
+    dims = (cp.c_int * 3)(zdim, ydim, xdim)
+
+    if base.dtype == np.uint8:
+        ndlib_ctypes.buildResolutionPyramid8(base, level_ptrs, cp.c_int(num_levels), dims)
+    elif base.dtype == np.uint16:
+        ndlib_ctypes.buildResolutionPyramid16(base, level_ptrs, cp.c_int(num_levels), dims)
+    elif base.dtype == np.uint32:
+        ndlib_ctypes.buildResolutionPyramid32(base, level_ptrs, cp.c_int(num_levels), dims)
+    elif base.dtype == np.uint64:
+        ndlib_ctypes.buildResolutionPyramid64(base, level_ptrs, cp.c_int(num_levels), dims)
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+
+    return levels
+
+
 def zoomInData_ctype(olddata, newdata, factor):
     """ Add the contribution of the input data to the next level at the given offset in the output cube """
 
@@ -414,6 +1945,8 @@ def zoomInData_ctype_OMP(olddata, newdata, factor):
     dims = [i for i in newdata.shape]
     if olddata.dtype == np.uint16:
         ndlib_ctypes.zoomInDataOMP16(olddata, newdata, (cp.c_int * len(dims))(*dims), cp.c_int(factor))
+    elif newdata.size >= INT32_MAX_VOXELS:
+        ndlib_ctypes.zoomInDataOMPL(olddata, newdata, (cp.c_int64 * len(dims))(*dims), cp.c_int(factor))
     else:
         ndlib_ctypes.zoomInDataOMP32(olddata, newdata, (cp.c_int * len(dims))(*dims), cp.c_int(factor))
     return (newdata)
@@ -423,15 +1956,65 @@ def mergeCube_ctype(data, newid, oldid):
     """ Relabel voxels in cube from oldid to newid """
 
     dims = [i for i in data.shape]
-    ndlib_ctypes.mergeCube(data, (cp.c_int * len(dims))(*dims), cp.c_int(newid), cp.c_int(oldid))
+    if data.dtype == np.uint32:
+        ndlib_ctypes.mergeCube(data, (cp.c_int * len(dims))(*dims), cp.c_int(newid), cp.c_int(oldid))
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.mergeCube8(data, (cp.c_int * len(dims))(*dims), cp.c_uint8(newid), cp.c_uint8(oldid))
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.mergeCube16(data, (cp.c_int * len(dims))(*dims), cp.c_uint16(newid), cp.c_uint16(oldid))
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.mergeCube64(data, (cp.c_int * len(dims))(*dims), cp.c_uint64(newid), cp.c_uint64(oldid))
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
     return (data)
 
 
-def isotropicBuild_ctype(data1, data2):
-    """ Merging Data """
+def mergeCubeBatch_ctype(data, merge_map):
+    """Relabel voxels in cube for a whole table of oldid -> newid pairs in one pass.
+
+    Replaces calling mergeCube_ctype once per pair, which reads the full cube
+    per merge; merging an equivalence class of n fragments costs O(voxels)
+    instead of O(voxels * n). Chained relabels (a -> b, b -> c) are applied
+    one step per voxel, so resolve chains in merge_map for transitive merges.
+
+    Args:
+        data (numpy.Array): 3D array, relabeled in place.
+        merge_map (dict): Mapping of oldid -> newid.
+
+    Returns:
+        (numpy.Array): data
+    """
+
+    if len(merge_map) == 0:
+        return (data)
+
+    oldids = np.array(list(merge_map.keys()), dtype=data.dtype)
+    newids = np.array(list(merge_map.values()), dtype=data.dtype)
+    if data.dtype == np.uint32:
+        ndlib_ctypes.mergeCubeBatch(data, cp.c_int64(data.size), oldids, newids, cp.c_int(len(oldids)))
+    elif data.dtype == np.uint8:
+        ndlib_ctypes.mergeCubeBatch8(data, cp.c_int64(data.size), oldids, newids, cp.c_int(len(oldids)))
+    elif data.dtype == np.uint16:
+        ndlib_ctypes.mergeCubeBatch16(data, cp.c_int64(data.size), oldids, newids, cp.c_int(len(oldids)))
+    elif data.dtype == np.uint64:
+        ndlib_ctypes.mergeCubeBatch64(data, cp.c_int64(data.size), oldids, newids, cp.c_int(len(oldids)))
+    else:
+        raise ValueError('data must be uint8, uint16, uint32 or uint64 data type')
+    return (data)
+
+
+def isotropicBuild_ctype(data1, data2, out=None):
+    """ Merging Data
+
+    out may hold a reusable array shaped and typed like data1 (e.g. from an
+    NdlibArena) to receive the merged result without a per-call allocation.
+    """
 
     dims = [i for i in data1.shape]
-    newdata = np.zeros(data1.shape, dtype=data1.dtype)
+    if out is not None and out.shape == data1.shape and out.dtype == data1.dtype:
+        newdata = out
+    else:
+        newdata = np.zeros(data1.shape, dtype=data1.dtype)
     if data1.dtype == np.uint32:
         ndlib_ctypes.isotropicBuild32(data1, data2, newdata, (cp.c_int * len(dims))(*dims))
     elif data1.dtype == np.uint8:
@@ -458,6 +2041,72 @@ def addDataToZSliceStack_ctype(cube, output, offset):
     dims = [i for i in cube.data.shape]
     ndlib_ctypes.addDataZSlice(cube.data, output, (cp.c_int * len(offset))(*offset), (cp.c_int * len(dims))(*dims))
 
+def addDataToZSliceStack_ctype_OMP(cube, output, offset, factor=2):
+    """Add the contribution of the input data to a coarser level at the given offset in the output cube.
+
+    OpenMP variant of addDataToZSliceStack_ctype. factor is any power of two and
+    applies the 2x2 vote iteratively, so factor=4 in one call matches two passes
+    of the legacy kernel. offset is the [x, y, z] voxel offset of the reduced
+    block inside output, whose extents are taken from output itself.
+    """
+
+    dims = [i for i in cube.data.shape]
+    outdims = [i for i in output.shape]
+    if cube.data.size >= INT32_MAX_VOXELS or output.size >= INT32_MAX_VOXELS:
+        if cube.data.dtype == np.uint32:
+            ndlib_ctypes.addDataZSliceOMPL(cube.data, output, (cp.c_int64 * len(offset))(*offset),
+                                           (cp.c_int64 * len(dims))(*dims),
+                                           (cp.c_int64 * len(outdims))(*outdims), cp.c_int(factor))
+        elif cube.data.dtype == np.uint64:
+            ndlib_ctypes.addDataZSliceOMPL64(cube.data, output, (cp.c_int64 * len(offset))(*offset),
+                                             (cp.c_int64 * len(dims))(*dims),
+                                             (cp.c_int64 * len(outdims))(*outdims), cp.c_int(factor))
+        else:
+            raise ValueError('data must be uint32 or uint64 data type')
+    elif cube.data.dtype == np.uint32:
+        ndlib_ctypes.addDataZSliceOMP(cube.data, output, (cp.c_int * len(offset))(*offset),
+                                      (cp.c_int * len(dims))(*dims),
+                                      (cp.c_int * len(outdims))(*outdims), cp.c_int(factor))
+    elif cube.data.dtype == np.uint64:
+        ndlib_ctypes.addDataZSliceOMP64(cube.data, output, (cp.c_int * len(offset))(*offset),
+                                        (cp.c_int * len(dims))(*dims),
+                                        (cp.c_int * len(outdims))(*outdims), cp.c_int(factor))
+    else:
+        raise ValueError('data must be uint32 or uint64 data type')
+
+
+def addDataToIsotropicStack_ctype_OMP(cube, output, offset, factor=2):
+    """Add the contribution of the input data to a coarser level at the given offset in the output cube.
+
+    OpenMP variant of addDataToIsotropicStack_ctype, reducing z as well as x and
+    y by any power-of-two factor. See addDataToZSliceStack_ctype_OMP.
+    """
+
+    dims = [i for i in cube.data.shape]
+    outdims = [i for i in output.shape]
+    if cube.data.size >= INT32_MAX_VOXELS or output.size >= INT32_MAX_VOXELS:
+        if cube.data.dtype == np.uint32:
+            ndlib_ctypes.addDataIsotropicOMPL(cube.data, output, (cp.c_int64 * len(offset))(*offset),
+                                              (cp.c_int64 * len(dims))(*dims),
+                                              (cp.c_int64 * len(outdims))(*outdims), cp.c_int(factor))
+        elif cube.data.dtype == np.uint64:
+            ndlib_ctypes.addDataIsotropicOMPL64(cube.data, output, (cp.c_int64 * len(offset))(*offset),
+                                                (cp.c_int64 * len(dims))(*dims),
+                                                (cp.c_int64 * len(outdims))(*outdims), cp.c_int(factor))
+        else:
+            raise ValueError('data must be uint32 or uint64 data type')
+    elif cube.data.dtype == np.uint32:
+        ndlib_ctypes.addDataIsotropicOMP(cube.data, output, (cp.c_int * len(offset))(*offset),
+                                         (cp.c_int * len(dims))(*dims),
+                                         (cp.c_int * len(outdims))(*outdims), cp.c_int(factor))
+    elif cube.data.dtype == np.uint64:
+        ndlib_ctypes.addDataIsotropicOMP64(cube.data, output, (cp.c_int * len(offset))(*offset),
+                                           (cp.c_int * len(dims))(*dims),
+                                           (cp.c_int * len(outdims))(*outdims), cp.c_int(factor))
+    else:
+        raise ValueError('data must be uint32 or uint64 data type')
+
+
 def addAnnotationData_ctype(volume, output, cubes, dim):
     """
     Downsample Annotations from a volume of shape (cubes * dim) into an output
@@ -473,13 +2122,15 @@ def addAnnotationData_ctype(volume, output, cubes, dim):
 
     convert = lambda x: (cp.c_int * len(x))(*x)
 
-    ndlib_ctypes.addAnnotationData(volume, output, convert(cubes), convert(dim))
+    ndlib_ctypes.addAnnotationDataOMP(volume, output, convert(cubes), convert(dim))
 
-def unique(data):
+def unique(data, out=None):
     """Return the unique elements in the array.
 
     Args:
         data (numpy.Array): 2D array.
+        out (numpy.Array): Optional reusable uint64 scratch array of at least
+        data.size elements; the return value is a view into it.
 
     Returns:
         (numpy.Array): Array of all unique elements in the input array.
@@ -487,11 +2138,164 @@ def unique(data):
     """
 
     data = data.ravel()
-    unique_array = np.zeros(len(data), dtype=data.dtype)
-    unique_length = ndlib_ctypes.unique(data, unique_array, cp.c_int(len(data)))
+    if out is not None and len(out) >= len(data):
+        unique_array = out[:len(data)]
+    else:
+        unique_array = np.zeros(len(data), dtype=data.dtype)
+    unique_length = ndlib_ctypes.uniqueOMP(data, unique_array, cp.c_int(len(data)))
 
     return unique_array[:unique_length]
 
+
+def unique_large(data, max_ids=1048576):
+    """Find the distinct non-zero ids in an arbitrarily large uint64 array.
+
+    64-bit clean variant of unique() for arrays past 2^31 elements, where
+    the sort-based kernel's int sizes overflow. Zero is dropped and the
+    scratch is bounded by max_ids rather than data.size, so this is also
+    the cheaper call when the id count is known to be small.
+
+    Args:
+        data (numpy.Array): uint64 array of any shape.
+        max_ids (int): Give up when more than this many distinct ids are present.
+
+    Returns:
+        (numpy.Array): Sorted uint64 array of the distinct non-zero ids, or
+        None if more than max_ids were present.
+
+    """
+
+    data = data.ravel()
+    ids = np.zeros(max_ids, dtype=np.uint64)
+    num_ids = ndlib_ctypes.uniqueOMPL(data, ids, cp.c_int64(len(data)), cp.c_int(max_ids))
+
+    if num_ids < 0:
+        return None
+    return np.copy(ids[:num_ids])
+
+
+def unique4d(data, max_ids=1048576):
+    """Find the distinct non-zero ids of every time sample in one call.
+
+    Replaces calling unique() once per sample of a (t, z, y, x) array, which
+    costs one ctypes crossing and one full sort per sample.
+
+    Args:
+        data (numpy.Array): C-contiguous 4D uint64 array in (t, z, y, x) order.
+        max_ids (int): Give up when more than this many ids are present in
+        total across all samples.
+
+    Returns:
+        (list[numpy.Array]): Sorted uint64 array of the distinct non-zero ids
+        of each time sample, or None if more than max_ids were present.
+
+    """
+
+    time_samples = data.shape[0]
+    sample_size = data.shape[1] * data.shape[2] * data.shape[3]
+    ids = np.zeros(max_ids, dtype=np.uint64)
+    offsets = np.zeros(time_samples + 1, dtype=np.int64)
+    total = ndlib_ctypes.unique4D(data, cp.c_int(time_samples), cp.c_int64(sample_size),
+                                  cp.c_int64(sample_size), cp.c_int(max_ids), ids, offsets)
+
+    if total < 0:
+        return None
+    return [np.copy(ids[offsets[t]:offsets[t + 1]]) for t in range(time_samples)]
+
+
+def id_histogram(data, max_ids=1048576):
+    """Count the voxels of every distinct non-zero id in one sort-free pass.
+
+    Replaces unique() plus np.unique(return_counts=True), which pays a full
+    sort of the cuboid just to count. Thread-local hash tables count over
+    voxel chunks and the merge runs in parallel over stripes of the id
+    space; only the distinct ids (bounded by max_ids, not data.size) are
+    sorted at the end. The counts let callers size index capacity or order
+    write_id_index calls by object size.
+
+    Args:
+        data (numpy.Array): uint64 array of any shape.
+        max_ids (int): Give up when more than this many distinct ids are present.
+
+    Returns:
+        (numpy.Array, numpy.Array): Sorted uint64 array of the distinct
+        non-zero ids and a uint64 array of their voxel counts, aligned by
+        position. None if more than max_ids were present.
+
+    """
+
+    data = data.ravel()
+    ids = np.zeros(max_ids, dtype=np.uint64)
+    counts = np.zeros(max_ids, dtype=np.uint64)
+    num_ids = ndlib_ctypes.idHistogramOMP(data, cp.c_int64(len(data)), cp.c_int(max_ids),
+                                          ids, counts)
+
+    if num_ids < 0:
+        return None
+    return np.copy(ids[:num_ids]), np.copy(counts[:num_ids])
+
+
+def unique_with_bounding_boxes(data, max_ids=16384):
+    """Find the unique non-zero ids in a cuboid and each id's tight bounding box in one pass.
+
+    Args:
+        data (numpy.Array): 3D uint64 array in (z, y, x) C order.
+        max_ids (int): Give up when more than this many distinct ids are present.
+
+    Returns:
+        (numpy.Array, numpy.Array): Sorted uint64 array of the non-zero ids and a
+        uint32 array of [x_min, x_max, y_min, y_max, z_min, z_max] rows (inclusive,
+        in cuboid-local coordinates), one per id. None if the cuboid held more than
+        max_ids distinct ids and the caller should fall back to unique().
+
+    """
+
+    if data.dtype != np.uint64:
+        raise ValueError('data must be uint64 data type')
+    if not data.flags['C_CONTIGUOUS']:
+        data = np.ascontiguousarray(data, dtype=np.uint64)
+
+    dims = [data.shape[2], data.shape[1], data.shape[0]]
+    unique_array = np.zeros((max_ids,), dtype=np.uint64)
+    boxes = np.zeros((max_ids, 6), dtype=np.uint32)
+
+    num_ids = ndlib_ctypes.uniqueBBoxOMP(data, (cp.c_int * len(dims))(*dims), cp.c_int(max_ids),
+                                         unique_array, boxes)
+    if num_ids < 0:
+        return None
+
+    return unique_array[:num_ids], boxes[:num_ids]
+
+
+def ids_in_region(arrays, max_ids=1048576):
+    """Union the non-zero ids across one or more uint64 arrays.
+
+    Args:
+        arrays (list[numpy.Array]): Contiguous uint64 arrays of equal size (an
+        assembled region may be passed as a single-element list).
+        max_ids (int): Give up when more than this many distinct ids are present.
+
+    Returns:
+        (numpy.Array): Sorted uint64 array of the non-zero ids. None if more than
+        max_ids distinct ids were present and the caller should fall back to
+        unioning per-array unique() results.
+
+    """
+
+    for array in arrays:
+        if array.dtype != np.uint64:
+            raise ValueError('data must be uint64 data type')
+
+    array_ptrs = (cp.c_void_p * len(arrays))(*[a.ctypes.data_as(cp.c_void_p) for a in arrays])
+    ids = np.zeros((max_ids,), dtype=np.uint64)
+
+    num_ids = ndlib_ctypes.idsInRegionOMP(array_ptrs, cp.c_int(len(arrays)),
+                                          cp.c_int64(arrays[0].size), cp.c_int(max_ids), ids)
+    if num_ids < 0:
+        return None
+
+    return ids[:num_ids]
+
 # def annoidIntersect_ctype_OMP(cutout, annoid_list):
 # """Remove all annotations in a cutout that do not match the filterlist using OpenMP"""
 
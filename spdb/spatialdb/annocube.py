@@ -85,12 +85,16 @@ class AnnotateCube64(Cube):
 
         if input_data.ndim == 4:
             for t in range(*time_sample_range):
-                self.data[t, :, :, :] = ndlib.overwriteDense64_ctype(
+                merged, _, changed = ndlib.overwriteDenseDirty_ctype(
                     self.data[t, :, :, :], input_data[t - time_sample_range[0], :, :, :])
+                self.data[t, :, :, :] = merged
+                self.mark_time_sample_dirty(t, changed > 0)
         else:
             # Input data doesn't have any time indices
-            self.data[time_sample_range[0], :, :, :] = ndlib.overwriteDense64_ctype(
+            merged, _, changed = ndlib.overwriteDenseDirty_ctype(
                 self.data[time_sample_range[0], :, :, :], input_data[time_sample_range[0], :, :, :])
+            self.data[time_sample_range[0], :, :, :] = merged
+            self.mark_time_sample_dirty(time_sample_range[0], changed > 0)
 
     def xy_image(self, z_index=0, t_index=0):
         """Render an image in the XY plane.
@@ -104,12 +108,11 @@ class AnnotateCube64(Cube):
             Image
         """
         _, zdim, ydim, xdim = self.data.shape
-        imagemap = np.zeros([ydim, xdim], dtype=np.uint64)
 
-        # false color redrawing of the region
-        ndlib.recolor_ctype(self.data[t_index, z_index, :, :].reshape((ydim, xdim)), imagemap)
+        # fused plane cut + false color redrawing of the region
+        tile = ndlib.render_tile(self.data[t_index, :, :, :], 'xy', z_index)
 
-        return Image.frombuffer('RGBA', (xdim, ydim), imagemap.astype(dtype=np.uint32), 'raw', 'RGBA', 0, 1)
+        return Image.frombuffer('RGBA', (xdim, ydim), tile, 'raw', 'RGBA', 0, 1)
 
     def xz_image(self, z_scale=1, y_index=0, t_index=0):
         """Render an image in the xz plane.
@@ -123,12 +126,11 @@ class AnnotateCube64(Cube):
             Image
         """
         _, zdim, ydim, xdim = self.data.shape
-        imagemap = np.zeros([zdim, xdim], dtype=np.uint64)
 
-        # false color redrawing of the region
-        ndlib.recolor_ctype(self.data[t_index, :, y_index, :].reshape((zdim, xdim)), imagemap)
+        # fused plane cut + false color redrawing of the region
+        tile = ndlib.render_tile(self.data[t_index, :, :, :], 'xz', y_index)
 
-        outimage = Image.frombuffer('RGBA', (xdim, zdim), imagemap.astype(dtype=np.uint32), 'raw', 'RGBA', 0, 1)
+        outimage = Image.frombuffer('RGBA', (xdim, zdim), tile, 'raw', 'RGBA', 0, 1)
         return outimage.resize([xdim, int(zdim * z_scale)])
 
     def yz_image(self, z_scale=1, x_index=0, t_index=0):
@@ -143,12 +145,11 @@ class AnnotateCube64(Cube):
             Image
         """
         _, zdim, ydim, xdim = self.data.shape
-        imagemap = np.zeros([zdim, ydim], dtype=np.uint64)
 
-        # false color redrawing of the region
-        ndlib.recolor_ctype(self.data[t_index, :, :, x_index].reshape((zdim, ydim)), imagemap)
+        # fused plane cut + false color redrawing of the region
+        tile = ndlib.render_tile(self.data[t_index, :, :, :], 'yz', x_index)
 
-        outimage = Image.frombuffer('RGBA', (ydim, zdim), imagemap.astype(dtype=np.uint32), 'raw', 'RGBA', 0, 1)
+        outimage = Image.frombuffer('RGBA', (ydim, zdim), tile, 'raw', 'RGBA', 0, 1)
         return outimage.resize([ydim, int(zdim * z_scale)])
 
     # TODO: Implement zoom in/zoom out once propagation is implemented
@@ -29,6 +29,10 @@ from .error import SpdbError, ErrorCodes
     :synopsis: Manipulate the in-memory data representation of the 3-D cube of data that contains image or annotations.
 """
 
+# Leading bytes of a run-length-encoded frame; a blosc frame never starts
+# with these, so unpack_array can tell the two serializations apart
+RLE_FRAME_MAGIC = b'NDRLE\x01\x00\x00'
+
 
 class Cube(metaclass=ABCMeta):
     """An abstract base class to store 3D matrix data with time-series support and perform common operations
@@ -64,6 +68,14 @@ class Cube(metaclass=ABCMeta):
         self.morton_id = None
         self.datatype = None
 
+        # In-memory element order of self.data: 'row' (C ordered z, y, x) or
+        # 'morton' (compact Z-curve, for annotation channels that opt in)
+        self.layout = 'row'
+
+        # Per time sample dirty flags recorded by overwrite(); None until an
+        # overwrite has run, at which point it maps time index -> bool
+        self.time_sample_dirty = None
+
         # Setup time sample properties
         if time_range:
             self.is_time_series = True
@@ -72,17 +84,56 @@ class Cube(metaclass=ABCMeta):
             self.is_time_series = False
             self.time_range = [0, 1]
 
-    def set_data(self, data):
+    def set_data(self, data, layout='row'):
         """Method to set the cube data matrix
 
         Args:
             data(np.ndarray):
+            layout(str): Element order of the provided matrix - 'row' for the
+            default C ordered (z, y, x) layout or 'morton' when the caller
+            already holds compact Z-curve ordered data. The flag becomes the
+            cube's default serialization layout.
 
         Returns:
             None
         """
+        if layout not in ('row', 'morton'):
+            raise SpdbError("Unsupported cube layout '{}'".format(layout),
+                            ErrorCodes.SPDB_ERROR)
         self.data = data
         self.datatype = data.dtype
+        self.layout = layout
+
+    def mark_time_sample_dirty(self, time_index, dirty):
+        """Record whether a time sample was changed by an overwrite operation
+
+        Args:
+            time_index (int): Time sample index as used by overwrite()
+            dirty (bool): True if the merge changed any voxel in the sample
+
+        Returns:
+            None
+        """
+        if self.time_sample_dirty is None:
+            self.time_sample_dirty = {}
+        self.time_sample_dirty[time_index] = dirty
+
+    def is_time_sample_dirty(self, time_index):
+        """Check whether a time sample was changed by the last overwrite.
+
+        Returns True when no dirty information has been recorded for the
+        sample, so callers that skip serialization of clean samples stay
+        correct for cubes that never ran an overwrite.
+
+        Args:
+            time_index (int): Time sample index as used by overwrite()
+
+        Returns:
+            bool
+        """
+        if self.time_sample_dirty is None:
+            return True
+        return self.time_sample_dirty.get(time_index, True)
 
     def add_data(self, input_cube, index):
         """Add data to a larger cube (this instance) from a smaller cube (input_cube)
@@ -124,12 +175,19 @@ class Cube(metaclass=ABCMeta):
         # update the cube dimensions, ignoring the time component since it does not change
         self.z_dim, self.y_dim, self.x_dim = self.cube_size = list(self.data.shape[1:])
 
-    def pack_array(self, data):
+    def pack_array(self, data, layout=None, encoding=None):
         """Method to serialize and compress data using the blosc compressor.
           Assumes the datatype of the passed in array if the datatype property is not set
 
         Args:
             data (np.ndarray): The array to pack
+            layout (str): Serialization layout, defaulting to the cube's layout
+            flag. 'morton' relayouts each row-major time sample into compact
+            Z-curve order before compression, so stored frames keep 2x2x2
+            neighborhoods contiguous for the morton-aware kernels.
+            encoding (str): 'rle' serializes the cuboid as a run-length-encoded
+            frame when it is run-compressible (sparse annotation cuboids),
+            falling back to blosc when it is not. Defaults to blosc.
 
         Returns:
             (bytes): The resulting serialized and compressed byte array
@@ -137,7 +195,24 @@ class Cube(metaclass=ABCMeta):
         if not self.datatype:
             self.datatype = data.dtype
 
-        return blosc.compress(data, typesize=(np.dtype(self.datatype).itemsize * 8))
+        if (layout or self.layout) == 'morton' and self.layout != 'morton':
+            data = np.stack([ndlib.to_morton_layout(data[t]) for t in range(data.shape[0])])
+
+        if encoding == 'rle':
+            runs = ndlib.rle_encode(np.ascontiguousarray(data))
+            if runs is not None:
+                return RLE_FRAME_MAGIC + np.uint64(len(runs) // 2).tobytes() + runs.tobytes()
+
+        typesize = np.dtype(self.datatype).itemsize * 8
+
+        # Compress through the native blosc stage when it is available, avoiding
+        # the python-blosc call overhead. Frames are interchangeable either way.
+        if data.flags['C_CONTIGUOUS'] and ndlib.blosc_available():
+            packed = ndlib.blosc_compress(data, typesize)
+            if packed is not None:
+                return packed
+
+        return blosc.compress(data, typesize=typesize)
 
     def to_blosc(self):
         """A method that packs data in this Cube instance using blosc compressor for all
@@ -179,7 +254,7 @@ class Cube(metaclass=ABCMeta):
             raise SpdbError("Failed to compress cube. {}".format(e),
                             ErrorCodes.SERIALIZATION_ERROR)
 
-    def unpack_array(self, data, num_time_points=1):
+    def unpack_array(self, data, num_time_points=1, layout=None):
         """Method to uncompress and deserialize the provided data.
 
         If only a single time point provided,
@@ -187,6 +262,9 @@ class Cube(metaclass=ABCMeta):
         Args:
             data (bytes): The array to pack
             num_time_points (int): Number of time samples in the compressed data
+            layout (str): Layout the frame was packed with, defaulting to the
+            cube's layout flag. 'morton' relayouts each decompressed time
+            sample from compact Z-curve order back to row-major.
 
         Returns:
             (np.ndarray): The resulting serialized and compressed byte array
@@ -195,9 +273,36 @@ class Cube(metaclass=ABCMeta):
             raise SpdbError("Cube instance must have datatype parameter set to enable deserialization.",
                             ErrorCodes.SERIALIZATION_ERROR)
 
-        raw_data = blosc.decompress(data)
-        data_mat = np.fromstring(raw_data, dtype=self.datatype)
-        data_mat = np.reshape(data_mat, (num_time_points, self.z_dim, self.y_dim, self.x_dim), order='C')
+        # Run-length-encoded frames are self-describing, so detect them by the
+        # magic bytes rather than requiring callers to track the encoding
+        if bytes(data[:len(RLE_FRAME_MAGIC)]) == RLE_FRAME_MAGIC:
+            header_end = len(RLE_FRAME_MAGIC) + 8
+            num_runs = int(np.frombuffer(data[len(RLE_FRAME_MAGIC):header_end], dtype=np.uint64)[0])
+            runs = np.frombuffer(data[header_end:header_end + 16 * num_runs], dtype=np.uint64)
+            data_mat = ndlib.rle_decode(runs, self.datatype,
+                                        (num_time_points, self.z_dim, self.y_dim, self.x_dim))
+            if (layout or self.layout) == 'morton' and self.layout != 'morton':
+                data_mat = np.stack([ndlib.from_morton_layout(data_mat[t]) for t in range(data_mat.shape[0])])
+            return data_mat
+
+        # Decompress directly into the output array when the native blosc stage
+        # is available, skipping the intermediate bytes object and extra copy
+        data_mat = None
+        if ndlib.blosc_available():
+            decompressed = np.empty((num_time_points, self.z_dim, self.y_dim, self.x_dim),
+                                    dtype=self.datatype, order='C')
+            if ndlib.blosc_decompress_into(data, decompressed):
+                data_mat = decompressed
+
+        if data_mat is None:
+            raw_data = blosc.decompress(data)
+            data_mat = np.fromstring(raw_data, dtype=self.datatype)
+            data_mat = np.reshape(data_mat, (num_time_points, self.z_dim, self.y_dim, self.x_dim), order='C')
+
+        # A morton-packed frame is relayouted back to row-major unless the cube
+        # itself holds Z-curve ordered data
+        if (layout or self.layout) == 'morton' and self.layout != 'morton':
+            data_mat = np.stack([ndlib.from_morton_layout(data_mat[t]) for t in range(data_mat.shape[0])])
 
         return data_mat
 
@@ -248,11 +353,17 @@ class Cube(metaclass=ABCMeta):
                             dtype=self.data.dtype)
                         missing_t = next(missing_gen)
                     else:
-                        self.data[data_idx, :, :, :] = self.unpack_array(byte_arrays[b_arr_idx], 1)
+                        # Decompress the time sample straight into its slice of the
+                        # cube matrix when the native blosc stage is available
+                        if not (ndlib.blosc_available() and
+                                ndlib.blosc_decompress_into(byte_arrays[b_arr_idx], self.data[data_idx, :, :, :])):
+                            self.data[data_idx, :, :, :] = self.unpack_array(byte_arrays[b_arr_idx], 1)
                         b_arr_idx += 1
             else:
                 # If you get a single array assume it is the complete 4D array
-                self.data[:, :, :, :] = self.unpack_array(byte_arrays, self.time_range[1] - self.time_range[0])
+                if not (ndlib.blosc_available() and self.data.flags['C_CONTIGUOUS'] and
+                        ndlib.blosc_decompress_into(byte_arrays, self.data)):
+                    self.data[:, :, :, :] = self.unpack_array(byte_arrays, self.time_range[1] - self.time_range[0])
                 #self.z_dim, self.y_dim, self.x_dim = self.cube_size = list(self.data.shape)[1:]
 
         except Exception as e:
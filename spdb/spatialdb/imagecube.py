@@ -86,12 +86,16 @@ class ImageCube8(Cube):
 
         if input_data.ndim == 4:
             for t in range(*time_sample_range):
-                self.data[t, :, :, :] = ndlib.overwriteDense8_ctype(
+                merged, _, changed = ndlib.overwriteDenseDirty_ctype(
                     self.data[t, :, :, :], input_data[t - time_sample_range[0], :, :, :])
+                self.data[t, :, :, :] = merged
+                self.mark_time_sample_dirty(t, changed > 0)
         else:
             # Input data doesn't have any time indices
-            self.data[time_sample_range[0], :, :, :] = ndlib.overwriteDense8_ctype(
+            merged, _, changed = ndlib.overwriteDenseDirty_ctype(
                 self.data[time_sample_range[0], :, :, :], input_data[time_sample_range[0], :, :, :])
+            self.data[time_sample_range[0], :, :, :] = merged
+            self.mark_time_sample_dirty(time_sample_range[0], changed > 0)
 
     def xy_image(self, z_index=0, t_index=0):
         """Render an image in the XY plane.
@@ -205,12 +209,16 @@ class ImageCube16(Cube):
 
         if input_data.ndim == 4:
             for t in range(*time_sample_range):
-                self.data[t, :, :, :] = ndlib.overwriteDense16_ctype(
+                merged, _, changed = ndlib.overwriteDenseDirty_ctype(
                     self.data[t, :, :, :], input_data[t - time_sample_range[0], :, :, :])
+                self.data[t, :, :, :] = merged
+                self.mark_time_sample_dirty(t, changed > 0)
         else:
             # Input data doesn't have any time indices
-            self.data[time_sample_range[0], :, :, :] = ndlib.overwriteDense16_ctype(
+            merged, _, changed = ndlib.overwriteDenseDirty_ctype(
                 self.data[time_sample_range[0], :, :, :], input_data[time_sample_range[0], :, :, :])
+            self.data[time_sample_range[0], :, :, :] = merged
+            self.mark_time_sample_dirty(time_sample_range[0], changed > 0)
 
     def xy_image(self, z_index=0, t_index=0):
         """Render an image in the XY plane.
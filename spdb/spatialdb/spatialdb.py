@@ -50,6 +50,9 @@ class SpatialDB:
                     "cache_host": If cache_client not provided, a string indicating the database host
                     "cache_db": If cache_client not provided, an integer indicating the database to use
                     "read_timeout": Integer indicating number of seconds a read cache key expires
+                    "ndlib_threads": Optional integer thread count for the ndlib kernels, applied
+                    once per process (defaults to the machine core count)
+                    "ndlib_affinity": Optional bool pinning the kernel threads to cores
                   }
 
 
@@ -89,6 +92,11 @@ class SpatialDB:
         self.state_conf = state_conf
         self.object_store_config = object_store_conf
 
+        # Apply the library-level kernel thread settings once per process so
+        # multi-worker deployments do not oversubscribe the host
+        if 'ndlib_threads' in kv_conf or 'ndlib_affinity' in kv_conf:
+            ndlib.ndlib_init(kv_conf.get('ndlib_threads', 0), kv_conf.get('ndlib_affinity', False))
+
         # Threshold number of cuboids for using lambda on reads
         self.read_lambda_threshold = 600  # Currently high since read lambda not implemented
         # Number of seconds to wait for dirty cubes to get clean
@@ -116,6 +124,32 @@ class SpatialDB:
         """
         self.kvio.close()
 
+    def log_kernel_stats(self, reset=False):
+        """Log the ndlib kernel instrumentation counters
+
+        Only produces output when ndlib.so was built with its counters
+        compiled in (STATS=-DNDLIB_STATS in makefile_LINUX), so calls are
+        safe to leave in place against a production build.
+
+        Args:
+            reset (bool): When True, zero the counters after logging.
+
+        Returns:
+            None
+
+        """
+        if not ndlib.stats_enabled():
+            return
+
+        log = logger('SpatialDB.kernel_stats')
+        for name, (calls, voxels, nanoseconds) in sorted(ndlib.stats_snapshot().items()):
+            if calls > 0:
+                log.info("ndlib {} - Calls: {} Voxels: {} Time: {:.3f}ms".format(
+                    name, calls, voxels, nanoseconds / 1000000.0))
+
+        if reset:
+            ndlib.stats_reset()
+
     # Cube Processing Methods
     def get_cubes(self, resource, key_list):
         """Load an array of cuboids from the cache key-value store as raw compressed byte arrays
@@ -462,14 +496,13 @@ class SpatialDB:
                                     [x_num_cubes * x_cube_dim, y_num_cubes * y_cube_dim, z_num_cubes * z_cube_dim],
                                     time_sample_range)
 
-        # Build a list of indexes to access
-        # TODO: Move this for loop directly into c-lib
-        list_of_idxs = []
-        for z in range(z_num_cubes):
-            for y in range(y_num_cubes):
-                for x in range(x_num_cubes):
-                    morton_idx = ndlib.XYZMorton([x + x_start, y + y_start, z + z_start])
-                    list_of_idxs.append(morton_idx)
+        # Build a list of indexes to access, computing every morton id in a single c-lib call
+        z_coord, y_coord, x_coord = np.meshgrid(np.arange(z_start, z_start + z_num_cubes, dtype=np.uint64),
+                                                np.arange(y_start, y_start + y_num_cubes, dtype=np.uint64),
+                                                np.arange(x_start, x_start + x_num_cubes, dtype=np.uint64),
+                                                indexing='ij')
+        cuboid_coords = np.column_stack((x_coord.ravel(), y_coord.ravel(), z_coord.ravel()))
+        list_of_idxs = ndlib.XYZMortonBatch(cuboid_coords).tolist()
 
         # Sort the indexes in Morton order
         list_of_idxs.sort()
@@ -647,13 +680,26 @@ class SpatialDB:
         #
 
         # Add all cuboids (which have all time samples packed in already) to final cube of data
-        for cube in cache_cuboids + s3_cuboids + zero_cuboids:
-            # Compute offset so data inserted properly
-            curxyz = ndlib.MortonXYZ(cube.morton_id)
-            offset = [curxyz[0] - lowxyz[0], curxyz[1] - lowxyz[1], curxyz[2] - lowxyz[2]]
+        all_cuboids = cache_cuboids + s3_cuboids + zero_cuboids
+        if all_cuboids and out_cube.data.flags['C_CONTIGUOUS'] and \
+                all(c.data is not None and c.data.flags['C_CONTIGUOUS'] and
+                    c.data.dtype == out_cube.data.dtype and
+                    c.data.shape == (out_cube.data.shape[0], z_cube_dim, y_cube_dim, x_cube_dim)
+                    for c in all_cuboids):
+            # Scatter every cuboid into the output array in a single c-lib call
+            ndlib.assembleCutout_ctype(out_cube.data,
+                                       [c.data for c in all_cuboids],
+                                       [c.morton_id for c in all_cuboids],
+                                       lowxyz)
+        else:
+            # Fall back to the per-cube copy when shapes or dtypes are mixed
+            for cube in all_cuboids:
+                # Compute offset so data inserted properly
+                curxyz = ndlib.MortonXYZ(cube.morton_id)
+                offset = [curxyz[0] - lowxyz[0], curxyz[1] - lowxyz[1], curxyz[2] - lowxyz[2]]
 
-            # add it to the output cube
-            out_cube.add_data(cube, offset)
+                # add it to the output cube
+                out_cube.add_data(cube, offset)
 
         # A smaller cube was cutout due to off-base resolution query: up-sample and trim
         base_res = channel.base_resolution
@@ -795,22 +841,30 @@ class SpatialDB:
 
         log.info("Writing Cuboid - Base Key: {}".format(base_write_cuboid_key))
 
+        # Compute every morton id for the write region in a single c-lib call
+        z_coord, y_coord, x_coord = np.meshgrid(np.arange(z_start, z_start + z_num_cubes, dtype=np.uint64),
+                                                np.arange(y_start, y_start + y_num_cubes, dtype=np.uint64),
+                                                np.arange(x_start, x_start + x_num_cubes, dtype=np.uint64),
+                                                indexing='ij')
+        cuboid_coords = np.column_stack((x_coord.ravel(), y_coord.ravel(), z_coord.ravel()))
+        morton_idxs = ndlib.XYZMortonBatch(cuboid_coords)
+
+        # Slice the write region into per-cuboid contiguous arrays in a single c-lib call
+        cuboid_arrays = ndlib.sliceCutout_ctype(data_buffer, morton_idxs,
+                                                [x_start, y_start, z_start], cube_dim)
+
         # Get current cube from db, merge with new cube, write back to the to db
-        # TODO: Move splitting up data and computing morton into c-lib as single method
         page_out_cnt = 0
         for z in range(z_num_cubes):
             for y in range(y_num_cubes):
                 for x in range(x_num_cubes):
                     # Get the morton ID for the cube
-                    morton_idx = ndlib.XYZMorton([x + x_start, y + y_start, z + z_start])
+                    morton_idx = int(morton_idxs[(z * y_num_cubes + y) * x_num_cubes + x])
 
                     # Get sub-cube
                     temp_cube = Cube.create_cube(resource, [x_cube_dim, y_cube_dim, z_cube_dim],
                                                  [time_sample_start, time_sample_stop])
-                    temp_cube.data = np.ascontiguousarray(data_buffer[:,
-                                                          z * z_cube_dim:(z + 1) * z_cube_dim,
-                                                          y * y_cube_dim:(y + 1) * y_cube_dim,
-                                                          x * x_cube_dim:(x + 1) * x_cube_dim], dtype=data_buffer.dtype)
+                    temp_cube.data = cuboid_arrays[(z * y_num_cubes + y) * x_num_cubes + x]
 
                     # For each time sample put cube into write-buffer and add to temp page out key
                     for t in range(time_sample_start, time_sample_stop):
@@ -905,12 +959,21 @@ class SpatialDB:
             (SpdbError): Can't talk to id index database or database corrupt.
         """
         cube = self.cutout(resource, corner, extent, resolution, t_range)
-        id_arr = np.unique(cube.data)
-        ids = []
-        for id in id_arr:
-            if id != 0:
-                # 0 is not a valid id.
-                ids.append('{}'.format(id))
+
+        # Union the non-zero ids in the c-lib when the cutout is in kernel form;
+        # fall back to numpy otherwise (or when the region holds too many ids)
+        id_arr = None
+        if cube.data.dtype == np.uint64 and cube.data.flags['C_CONTIGUOUS']:
+            id_arr = ndlib.ids_in_region([cube.data])
+
+        if id_arr is not None:
+            ids = ['{}'.format(id) for id in id_arr]
+        else:
+            ids = []
+            for id in np.unique(cube.data):
+                if id != 0:
+                    # 0 is not a valid id.
+                    ids.append('{}'.format(id))
 
         return {'ids': ids}
 